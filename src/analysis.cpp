@@ -0,0 +1,347 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include "particlesystem.h"
+#include "orderparameters.h"
+#include "qdata.h"
+#include "threadpool.h"
+#include "taskgraph.h"
+#include "constants.h"
+#include "utility.h"
+#include "gtensor.h"
+#include "interface.h"
+#include "clusterstats.h"
+#include "analysis.h"
+
+using std::endl;
+using std::string;
+using std::vector;
+
+// Format a value in the same way as printing it to cout.
+
+template <class T>
+string tostring(const T& value)
+{
+   std::ostringstream ss;
+   ss << value;
+   return ss.str();
+}
+
+// Compute the data for the configuration in psystem.  If clustersonly
+// is true, stop once the clusters have been found (see the -c option).
+
+void analyse(const ParticleSystem& psystem, FrameData& fd, const bool clustersonly)
+{
+   // The stages below are run as a task graph (see taskgraph.h), so
+   // that stages which don't depend on each other, e.g. the LD and TF
+   // largest clusters, can run at the same time.
+   TaskGraph stages(threadpool());
+
+   // compute the qlm data
+   // warning: at the moment the number of links, and the threshold
+   // value for a link is the same for both l=4 and l=6
+   // (psystem.linval and psystem.nlinks respectively)
+   // The spherical harmonics for l = 6 and l = 4 are computed
+   // together, see multiqdata.
+   int qtask = stages.add([&] { multiqdata(psystem, {6, 4}, fd.qdata); });
+	  
+   // from q6data and q4 data, classify each particle as bcc, hcp
+   // etc.  using Lechner Dellago approach.
+   int ldtask = stages.add([&] {
+      fd.ldclass = classifyparticlesld(psystem, fd.qdata[1], fd.qdata[0]);
+   }, {qtask});
+
+   // from q6 data only, classify each particle as either
+   // crystalline or liquid, using TenWolde Frenkel approach
+   int tftask = stages.add([&] { fd.tfclass = classifyparticlestf(psystem, fd.qdata[0]); },
+                           {qtask});
+
+   // indices into particle vector (psystem.allpars) of those
+   // particles in the ten-Wolde Frenkel largest cluster and those
+   // in the Lechner Dellago cluster.
+   // (the clusters for both are found in the same sweep, see
+   // xtalclusters)
+   int ctask = stages.add([&] {
+      xtalclusters(psystem, fd.ldclass, fd.tfclass, fd.xclusters);
+      fd.ldcnums = fd.xclusters[0].members(fd.xclusters[0].largest());
+      fd.tfcnums = fd.xclusters[1].members(fd.xclusters[1].largest());
+   }, {ldtask, tftask});
+
+   if (!clustersonly) {
+      // liquid like particles that have at least one neighbour in the
+      // cluster
+      stages.add([&] {
+         fd.interfaces = xtalinterfaces(psystem, fd.ldclass, fd.tfclass, fd.xclusters,
+                                        fd.xclusters[0].largest(), fd.xclusters[1].largest(),
+                                        fd.qdata[0], fd.qdata[1]);
+      }, {ctask});
+
+      // radius of gyration tensor for both clusters
+      stages.add([&] { fd.tfgtensor.emplace(psystem, fd.tfcnums); }, {ctask});
+      stages.add([&] { fd.ldgtensor.emplace(psystem, fd.ldcnums); }, {ctask});
+   }
+
+   stages.run();
+
+   // there are no particles if the positions could not be read
+   const int npar = psystem.allpars.size();
+   fd.pindices = range(std::min<int>(psystem.nsurf, npar), npar);
+}
+
+// The order parameters for the data in fd.
+//
+// Currently there are 42 different order parameters output, but a
+// lot of these are 'duplicated' because there are two different
+// definitions of the largest crystalline cluster in the system (one
+// uses the so-called Ten-Wolde Frenkel approach, the other uses the
+// Lecher-Dellago approach ). See README for further information.
+
+vector<OrderParam> orderparams(const FrameData& fd)
+{
+   // each order parameter is a name and a function that returns its
+   // value (formatted for output).  See orderparams.cpp for these
+   // functions.
+   vector<OrderParam> ops;
+
+   //////////////////////////////////////////////////////////////////
+   // The following order parameters are associated in some way with
+   // properties of the largest cluster.  There are two approaches
+   // to determining this cluster, which I call Lecher Dellage (LD)
+   // and ten-Wolde Frenkel (TF), and thus two different clusters.
+   // All of the OPs are computed for both clusters.
+   /////////////////////////////////////////////////////////////////
+	  
+   // Size of cluster by LD method
+   ops.push_back(OrderParam("N_ld", [&fd] { return tostring(csizeld(fd.ldcnums)); }));
+
+   // Size of cluster by TF method
+   ops.push_back(OrderParam("N_tf", [&fd] { return tostring(csizetf(fd.tfcnums)); }));
+	  
+   // fraction of bcc pars in LD cluster
+   ops.push_back(OrderParam("n_bccLD", [&fd] { return tostring(parfrac(fd.ldclass, fd.ldcnums, BCC)); }));
+	  
+   // fraction of bcc pars in TF cluster	  
+   ops.push_back(OrderParam("n_bccTF", [&fd] { return tostring(parfrac(fd.ldclass, fd.tfcnums, BCC)); }));
+	  
+   // fraction of fcc pars in LD cluster
+   ops.push_back(OrderParam("n_fccLD", [&fd] { return tostring(parfrac(fd.ldclass, fd.ldcnums, FCC)); }));
+	  
+   // fraction of fcc pars in TF cluster	  
+   ops.push_back(OrderParam("n_fccTF", [&fd] { return tostring(parfrac(fd.ldclass, fd.tfcnums, FCC)); }));
+	  
+   // fraction of hcp pars in LD cluster
+   ops.push_back(OrderParam("n_hcpLD", [&fd] { return tostring(parfrac(fd.ldclass, fd.ldcnums, HCP)); }));
+	  
+   // fraction of hcp pars in TF cluster	  
+   ops.push_back(OrderParam("n_hcpTF", [&fd] { return tostring(parfrac(fd.ldclass, fd.tfcnums, HCP)); }));
+	  
+   // fraction of icos pars in LD cluster
+   ops.push_back(OrderParam("n_icosLD", [&fd] { return tostring(parfrac(fd.ldclass, fd.ldcnums, ICOS)); }));
+	  
+   // // fraction of icos pars in TF cluster	  
+   ops.push_back(OrderParam("n_icosTF", [&fd] { return tostring(parfrac(fd.ldclass, fd.tfcnums, ICOS)); }));
+	 
+   // average Q6 of LD cluster
+   ops.push_back(OrderParam("Q6clusLD", [&fd] { return tostring(qavgroup(fd.qdata[0], fd.ldcnums)); }));
+
+   // average Q6 of TF cluster
+   ops.push_back(OrderParam("Q6clusTF", [&fd] { return tostring(qavgroup(fd.qdata[0], fd.tfcnums)); }));
+	  	 
+   // average Q4 of LD cluster
+   ops.push_back(OrderParam("Q4clusLD", [&fd] { return tostring(qavgroup(fd.qdata[1], fd.ldcnums)); }));
+
+   // average Q4 of TF cluster
+   ops.push_back(OrderParam("Q4clusTF", [&fd] { return tostring(qavgroup(fd.qdata[1], fd.tfcnums)); }));
+
+   // number of liquid like particles with at least one neighbour in
+   // LD cluster
+   ops.push_back(OrderParam("N_sLD", [&fd] { return tostring(fd.interfaces[0].num()); }));
+
+   // same as above but for TF cluster
+   ops.push_back(OrderParam("N_sTF", [&fd] { return tostring(fd.interfaces[1].num()); }));
+
+   // total number of connections for all liquid-like particles with
+   // at least one neighbour in cluster for LD cluster
+   ops.push_back(OrderParam("N_lLD", [&fd] { return tostring(fd.interfaces[0].nlinks); }));
+
+   // // same as above but for TF cluster
+   ops.push_back(OrderParam("N_lTF", [&fd] { return tostring(fd.interfaces[1].nlinks); }));
+
+   // average q6 of liquid-like particles with at least one
+   // neighbour in cluster for LD cluster
+   ops.push_back(OrderParam("Q6N_sLD", [&fd] { return tostring(fd.interfaces[0].q6); }));
+
+   // same as above but for TF cluster
+   ops.push_back(OrderParam("Q6N_sTF", [&fd] { return tostring(fd.interfaces[1].q6); }));
+
+   // average q4 of liquid-like particles with at least one
+   // neighbour in cluster for LD cluster
+   ops.push_back(OrderParam("Q4N_sLD", [&fd] { return tostring(fd.interfaces[0].q4); }));
+
+   // same as above but for LD cluster
+   ops.push_back(OrderParam("Q4N_sTF", [&fd] { return tostring(fd.interfaces[1].q4); }));
+
+   // smallest eigenvalue of gyration tensor for LD cluster
+   ops.push_back(OrderParam("Rbar_g,1LD", [&fd] { return tostring(eigsmall(*fd.ldgtensor)); }));
+
+   // smallest eigenvalue of gyration tensor for TF cluster
+   ops.push_back(OrderParam("Rbar_g,1TF", [&fd] { return tostring(eigsmall(*fd.tfgtensor)); }));
+
+   // middle eigenvalue of gyration tensor for LD cluster
+   ops.push_back(OrderParam("Rbar_g,2LD", [&fd] { return tostring(eigmid(*fd.ldgtensor)); }));
+
+   // middle eigenvalue of gyration tensor for TF cluster
+   ops.push_back(OrderParam("Rbar_g,2TF", [&fd] { return tostring(eigmid(*fd.tfgtensor)); }));
+
+   // largest eigenvalue of gyration tensor for LD cluster
+   ops.push_back(OrderParam("Rbar_g,3LD", [&fd] { return tostring(eiglarge(*fd.ldgtensor)); }));
+	  
+   // largest eigenvalue of gyration tensor for TF cluster
+   ops.push_back(OrderParam("Rbar_g,3TF", [&fd] { return tostring(eiglarge(*fd.tfgtensor)); }));
+
+   // square of 'radius of gyration' for LD cluster
+   ops.push_back(OrderParam("Rbar_gLD", [&fd] { return tostring(rogsquared(*fd.ldgtensor)); }));
+
+   // square of 'radius of gyration' for TF cluster
+   ops.push_back(OrderParam("Rbar_gTF", [&fd] { return tostring(rogsquared(*fd.tfgtensor)); }));
+	  
+   // (3,3) element of non-diagonalized gyration tensor for LD
+   // cluster
+   ops.push_back(OrderParam("R_g,zLD", [&fd] { return tostring(element33(*fd.ldgtensor)); }));
+	  
+   // (3,3) element of non-diagonalized gyration tensor for TF
+   // cluster
+   ops.push_back(OrderParam("R_g,zTF", [&fd] { return tostring(element33(*fd.tfgtensor)); }));
+
+   // smallest eigenvalue of top-diagonalised gyration tensor for LD
+   // cluster
+   ops.push_back(OrderParam("R_g,1LD", [&fd] { return tostring(eigsmalltop(*fd.ldgtensor)); }));
+
+   // smallest eigenvalue of top-diagonalised gyration tensor for TF
+   // cluster
+   ops.push_back(OrderParam("R_g,1TF", [&fd] { return tostring(eigsmalltop(*fd.tfgtensor)); }));
+
+   // largest eigenvalue of top-diagonalised gyration tensor for LD
+   // cluster
+   ops.push_back(OrderParam("R_g,2LD", [&fd] { return tostring(eiglargetop(*fd.ldgtensor)); }));
+
+   // largest eigenvalue of top-diagonalised gyration tensor for TF
+   // cluster
+   ops.push_back(OrderParam("R_g,2TF", [&fd] { return tostring(eiglargetop(*fd.tfgtensor)); }));
+
+   //////////////////////////////////////////////////////////////////
+   // These order parameter are 'global' i.e. for the entire system
+   // (that is, no mention of a cluster of any kind!).  Note that we
+   // exclude surface particles from the calculations.
+   //////////////////////////////////////////////////////////////////
+	  
+   // fraction of bcc particles in entire system
+   ops.push_back(OrderParam("s_bcc", [&fd] { return tostring(parfrac(fd.ldclass, fd.pindices, BCC)); }));
+	  
+   // fraction of fcc particles in entire system
+   ops.push_back(OrderParam("s_fcc", [&fd] { return tostring(parfrac(fd.ldclass, fd.pindices, FCC)); }));
+	  
+   // fraction of hcp particles in entire system
+   ops.push_back(OrderParam("s_hcp", [&fd] { return tostring(parfrac(fd.ldclass, fd.pindices, HCP)); }));
+
+   // fraction of icosahedral particles in entire system
+   ops.push_back(OrderParam("s_icos", [&fd] { return tostring(parfrac(fd.ldclass, fd.pindices, ICOS)); }));
+
+   // Average q6 of all particles in system
+   ops.push_back(OrderParam("Q6", [&fd] { return tostring(qavgroup(fd.qdata[0], fd.pindices)); }));
+
+   // average q4 of all particles in system
+   ops.push_back(OrderParam("Q4", [&fd] { return tostring(qavgroup(fd.qdata[1], fd.pindices)); }));
+
+   return ops;
+}
+
+// Compute the value of every order parameter.  The order parameters
+// are independent of each other, so they are all computed at once.
+
+vector<string> opvalues(const vector<OrderParam>& ops)
+{
+   vector<string> opvals(ops.size());
+   threadpool().parallelfor(ops.size(), 1, [&](int begin, int end) {
+      for (int i = begin; i != end; ++i) {
+         opvals[i] = ops[i].second();
+      }
+   });
+   return opvals;
+}
+
+// Print the statistics of every LD and TF cluster (-c option).
+
+void printallclusters(std::ostream& out, const ParticleSystem& psystem, const FrameData& fd)
+{
+   vector<ClusterStats> ldstats = clusterstats(psystem, fd.xclusters[0], fd.ldclass,
+                                               fd.qdata[0], fd.qdata[1]);
+   vector<ClusterStats> tfstats = clusterstats(psystem, fd.xclusters[1], fd.ldclass,
+                                               fd.qdata[0], fd.qdata[1]);
+   out << "# LD clusters" << endl;
+   printclusterstats(out, ldstats);
+   out << "# TF clusters" << endl;
+   printclusterstats(out, tfstats);
+}
+
+// The gyration tensor of a cluster that is connected to its own
+// periodic image isn't very meaningful, so warn about this.  frame is
+// the frame number in trajectory mode (-1 otherwise).  The warnings
+// are written among the results, so they are comment lines (starting
+// with '#'), which programs reading the output as a table skip.
+
+void percolationwarnings(std::ostream& out, const FrameData& fd, const int frame)
+{
+   const char dims[] = {'x', 'y', 'z'};
+   for (int d = 0; d != 3; ++d) {
+      if (fd.ldgtensor->percolates[d]) {
+         out << "# Warning: LD cluster percolates in " << dims[d];
+         if (frame >= 0) {
+            out << " (frame " << frame << ")";
+         }
+         out << endl;
+      }
+      if (fd.tfgtensor->percolates[d]) {
+         out << "# Warning: TF cluster percolates in " << dims[d];
+         if (frame >= 0) {
+            out << " (frame " << frame << ")";
+         }
+         out << endl;
+      }
+   }
+}
+
+// Write each line of text to out as a comment line (starting with
+// '#'), e.g. the warnings from reading a frame of a trajectory, so that
+// they are skipped in the same way as the percolation warnings.
+
+void commentlines(const string& text, std::ostream& out)
+{
+   std::istringstream ss(text);
+   string sline;
+   while (getline(ss, sline)) {
+      out << "# " << sline << endl;
+   }
+}
+
+// Analyse the configuration in psystem and print the order parameters
+// ops (one per line), or with allclusters the statistics of every
+// cluster, to out.  This is the output of orderparams for a single
+// configuration.
+
+void printconfig(std::ostream& out, const ParticleSystem& psystem, FrameData& fd,
+                 const vector<OrderParam>& ops, const bool allclusters)
+{
+   analyse(psystem, fd, allclusters);
+   if (allclusters) {
+      printallclusters(out, psystem, fd);
+      return;
+   }
+   percolationwarnings(out, fd, -1);
+   vector<string> opvals = opvalues(ops);
+   for (vector<OrderParam>::size_type i = 0; i != ops.size(); ++i) {
+      out << ops[i].first << " " << opvals[i] << endl;
+   }
+}
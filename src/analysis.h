@@ -0,0 +1,57 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <functional>
+#include <optional>
+#include <utility>
+#include "particlesystem.h"
+#include "qdata.h"
+#include "clusters.h"
+#include "interface.h"
+#include "gtensor.h"
+#include "constants.h"
+
+// Each order parameter is a name and a function that returns its
+// value (formatted for output).
+
+typedef std::pair<std::string, std::function<std::string()> > OrderParam;
+
+// Everything that is computed for a configuration.  In trajectory
+// mode (see main) the same FrameData is used for every frame, so that
+// the storage of the qlm data, the clusters etc. is reused rather than
+// allocated again for each frame.
+
+struct FrameData
+{
+   // qlm data for l = 6 (element 0) and l = 4 (element 1)
+   std::vector<QData> qdata;
+   std::vector<LDCLASS> ldclass;
+   std::vector<TFCLASS> tfclass;
+   // LD (element 0) and TF (element 1) clusters, and the particles in
+   // the largest cluster of each
+   std::vector<Clusters> xclusters;
+   std::vector<int> ldcnums;
+   std::vector<int> tfcnums;
+   // liquid like particles that have at least one neighbour in the
+   // largest cluster, for both ld (element 0) and tf (element 1)
+   std::vector<Interface> interfaces;
+   std::optional<GTensor> tfgtensor;
+   std::optional<GTensor> ldgtensor;
+   // indexes of all particles (minus surface particles)
+   std::vector<int> pindices;
+};
+
+void analyse(const ParticleSystem&, FrameData&, bool);
+std::vector<OrderParam> orderparams(const FrameData&);
+std::vector<std::string> opvalues(const std::vector<OrderParam>&);
+void printallclusters(std::ostream&, const ParticleSystem&, const FrameData&);
+void percolationwarnings(std::ostream&, const FrameData&, int);
+void commentlines(const std::string&, std::ostream&);
+void printconfig(std::ostream&, const ParticleSystem&, FrameData&,
+                 const std::vector<OrderParam>&, bool);
+
+#endif
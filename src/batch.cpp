@@ -0,0 +1,149 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include "particlesystem.h"
+#include "readwrite.h"
+#include "snapshot.h"
+#include "decompress.h"
+#include "threadpool.h"
+#include "analysis.h"
+#include "batch.h"
+
+using std::string;
+using std::vector;
+using std::cout;
+using std::endl;
+
+// The storage used to analyse a configuration: the particle system
+// and everything computed from it.  One of these is kept for each
+// configuration being analysed at the same time, and is reused for the
+// next one.
+
+struct BatchBuffers
+{
+   BatchBuffers() : ops(orderparams(fd)) { }
+
+   ParticleSystem psystem;
+   FrameData fd;
+   vector<OrderParam> ops;
+};
+
+// Number of particles in the configuration given by parameter file
+// pfile (the top line of its XYZ file, or from the header of a
+// snapshot file, either of which may be compressed), used to order the
+// jobs.  No warnings are given here, since the job that reads the file
+// gives them with its output.
+
+static long numparticles(const string& pfile)
+{
+   std::map<string, string> params = readparams(pfile);
+   std::ostringstream unused;
+   if (issnapshot(params["filename"])) {
+      Snapshot snap;
+      return snap.open(params["filename"], unused) ? snap.numparticles() : 0;
+   }
+   std::unique_ptr<std::istream> infile = openinput(params["filename"], unused);
+   long npar = 0;
+   if (infile) {
+      *infile >> npar;
+   }
+   return npar;
+}
+
+void runbatch(const string& manifest, const bool allclusters, std::ostream& out)
+{
+   // parameter files from the manifest
+   std::ifstream infile(manifest.c_str());
+   if (!infile) {
+      cout << "Warning: " << manifest << " does not exist or cannot be read." << endl;
+      return;
+   }
+   vector<string> pfiles;
+   string sline;
+   while (getline(infile, sline)) {
+      std::istringstream ss(sline);
+      string pfile;
+      if (!(ss >> pfile) || pfile[0] == '#') {
+         continue;
+      }
+      if (!std::ifstream(pfile.c_str())) {
+         cout << "Warning: " << pfile << " does not exist or cannot be read, skipping."
+              << endl;
+         continue;
+      }
+      pfiles.push_back(pfile);
+   }
+   const int njob = pfiles.size();
+
+   // largest configurations first
+   vector<long> sizes(njob);
+   vector<int> order(njob);
+   for (int j = 0; j != njob; ++j) {
+      sizes[j] = numparticles(pfiles[j]);
+      order[j] = j;
+   }
+   std::stable_sort(order.begin(), order.end(),
+                    [&](int a, int b) { return sizes[a] > sizes[b]; });
+
+   // buffers that aren't being used by a job at the moment, and the
+   // output of each job, which is written in manifest order.  There is
+   // a fixed number of buffers, one for each thread of the pool, which
+   // caps the memory used however the jobs are scheduled.
+   std::mutex mtx;
+   std::condition_variable freed;
+   vector<std::unique_ptr<BatchBuffers> > spare;
+   for (int b = 0; b != std::min(njob, threadpool().size()); ++b) {
+      spare.push_back(std::unique_ptr<BatchBuffers>(new BatchBuffers()));
+   }
+   vector<string> results(njob);
+   vector<char> done(njob, 0);
+   int nwritten = 0;
+
+   // the jobs are handed out to the threads one at a time; each job
+   // can also use the pool itself, and a thread that is waiting for
+   // some of that work may start another job in the meantime.  It can
+   // only do so by running one of the loop bodies of this parallelfor,
+   // of which there are at most threadpool().size(), each holding one
+   // buffer at a time, so a job never actually has to wait for a
+   // buffer below.
+   threadpool().parallelfor(njob, 1, [&](int begin, int end) {
+      for (int n = begin; n != end; ++n) {
+         const int job = order[n];
+         std::unique_ptr<BatchBuffers> buf;
+         {
+            std::unique_lock<std::mutex> lock(mtx);
+            freed.wait(lock, [&] { return !spare.empty(); });
+            buf = std::move(spare.back());
+            spare.pop_back();
+         }
+
+         // the warnings from reading the configuration go after the
+         // header of its output, as comment lines
+         std::ostringstream warn;
+         buf->psystem.load(pfiles[job], true, warn);
+         std::ostringstream ss;
+         ss << "# " << pfiles[job] << endl;
+         commentlines(warn.str(), ss);
+         printconfig(ss, buf->psystem, buf->fd, buf->ops, allclusters);
+
+         std::lock_guard<std::mutex> lock(mtx);
+         spare.push_back(std::move(buf));
+         freed.notify_one();
+         results[job] = ss.str();
+         done[job] = 1;
+         while (nwritten != njob && done[nwritten]) {
+            out << results[nwritten];
+            string().swap(results[nwritten]);
+            ++nwritten;
+         }
+      }
+   });
+   out.flush();
+}
@@ -0,0 +1,19 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include <iostream>
+
+// Analyse every configuration in a manifest, i.e. a file listing
+// parameter files (one per line, lines starting with # are comments),
+// and write the output of each (see printconfig in analysis.h) to out,
+// in manifest order.  The configurations are independent, so they are
+// analysed at the same time on the thread pool, largest first so that
+// a big configuration isn't left until the end.  There is one set of
+// storage for each thread, which is reused from one configuration to
+// the next, and the output of each configuration is written as soon as
+// all of the configurations before it are done.
+
+void runbatch(const std::string&, bool, std::ostream&);
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <utility>
+
+// BoundedQueue passes items from one thread to another, e.g. between
+// the stages of the trajectory pipeline (see trajectory.h).  push
+// waits while the queue is full, so a fast stage can only get a fixed
+// number of items ahead of a slow one, and pop waits while it is
+// empty.  Once close has been called, pop returns false when there are
+// no items left, which tells the consumer that the producer is done,
+// and push returns false (without adding the item), which tells the
+// producer that the consumer has stopped.
+
+template <class T>
+class BoundedQueue
+{
+public:
+   explicit BoundedQueue(int _capacity) : capacity(_capacity), closed(false) { }
+
+   bool push(T item)
+   {
+      std::unique_lock<std::mutex> lock(mtx);
+      notfull.wait(lock, [this] { return closed || static_cast<int>(items.size()) < capacity; });
+      if (closed) {
+         return false;
+      }
+      items.push_back(std::move(item));
+      notempty.notify_one();
+      return true;
+   }
+
+   bool pop(T& item)
+   {
+      std::unique_lock<std::mutex> lock(mtx);
+      notempty.wait(lock, [this] { return closed || !items.empty(); });
+      if (items.empty()) {
+         return false;
+      }
+      item = std::move(items.front());
+      items.pop_front();
+      notfull.notify_one();
+      return true;
+   }
+
+   void close()
+   {
+      std::lock_guard<std::mutex> lock(mtx);
+      closed = true;
+      notempty.notify_all();
+      notfull.notify_all();
+   }
+
+private:
+   int capacity;
+   bool closed;
+   std::deque<T> items;
+   std::mutex mtx;
+   std::condition_variable notfull;
+   std::condition_variable notempty;
+};
+
+#endif
@@ -29,10 +29,14 @@ public:
    inline bool getvalidifnot(double* pos) const;
 
    inline void setdims(double lx, double ly, double lz);
+
+   // box dimensions (d = 0, 1, 2 for x, y, z), and whether the box is
+   // periodic in z, e.g. for writing a snapshot file
+   double length(int d) const { return d == 0 ? lboxx : (d == 1 ? lboxy : lboxz); }
+   bool zperiodic() const { return periodicz; }
      
-   // the following friends are in gtensor.cpp
-   friend std::vector<Particle> replicate(const std::vector<Particle>&, const Box&);
-   friend std::vector<Particle> posnoperiodic(const std::vector<Particle>&, const Box&);
+   // needs the box dimensions to divide the box into cells
+   friend class CellList;
 
 private:
    double lboxx;
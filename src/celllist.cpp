@@ -0,0 +1,143 @@
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "particle.h"
+#include "box.h"
+#include "celllist.h"
+
+using std::vector;
+
+// Constructor for cell list containing all particles.
+
+CellList::CellList(const vector<Particle>& particles, const Box& simbox)
+   : allpars(&particles), pnums(0), box(simbox)
+{
+   build(simbox);
+}
+
+// Constructor for cell list containing the particles with indices
+// pnums only (e.g. the crystalline particles).
+
+CellList::CellList(const vector<Particle>& particles, const vector<int>& _pnums,
+                   const Box& simbox)
+   : allpars(&particles), pnums(&_pnums), box(simbox)
+{
+   build(simbox);
+}
+
+// Rebuild the cell list for all of the particles, the storage of the
+// previous index is reused.
+
+void CellList::reset(const vector<Particle>& particles, const Box& simbox)
+{
+   allpars = &particles;
+   pnums = 0;
+   box = simbox;
+   build(simbox);
+}
+
+// Divide the box into cells and sort the particles into them.
+
+void CellList::build(const Box& simbox)
+{
+   const double lbox[3] = {simbox.lboxx, simbox.lboxy, simbox.lboxz};
+   periodic[0] = true;
+   periodic[1] = true;
+   periodic[2] = simbox.periodicz;
+
+   // cells must be at least as wide as the neighbour separation; in a
+   // periodic direction they must also divide the box exactly
+   int ntot = 1;
+   for (int d = 0; d != 3; ++d) {
+      ncell[d] = 1;
+      if (simbox.nsep > 0.0 && lbox[d] > simbox.nsep) {
+         ncell[d] = static_cast<int>(lbox[d] / simbox.nsep);
+      }
+      invwidth[d] = (lbox[d] > 0.0) ? ncell[d] / lbox[d] : 0.0;
+      ntot *= ncell[d];
+   }
+
+   int npar = pnums ? pnums->size() : allpars->size();
+   head.assign(ntot, -1);
+   next.resize(npar);
+   cell.resize(npar);
+
+   // insert in reverse so that each cell is traversed in ascending
+   // particle order
+   int c[3];
+   for (int i = npar - 1; i >= 0; --i) {
+      cellcoords(particle(i).pos, c);
+      cell[i] = (c[2] * ncell[1] + c[1]) * ncell[0] + c[0];
+      next[i] = head[cell[i]];
+      head[cell[i]] = i;
+   }
+}
+
+// Cell coordinates of position pos.  Positions slightly outside the
+// box are wrapped in periodic directions, and put in the end cells in
+// the non-periodic direction.
+
+void CellList::cellcoords(const double* pos, int* c) const
+{
+   for (int d = 0; d != 3; ++d) {
+      c[d] = static_cast<int>(std::floor(pos[d] * invwidth[d]));
+      if (periodic[d]) {
+         c[d] = c[d] % ncell[d];
+         if (c[d] < 0) {
+            c[d] += ncell[d];
+         }
+      }
+      else {
+         c[d] = std::max(0, std::min(c[d], ncell[d] - 1));
+      }
+   }
+}
+
+// Indices of all neighbours of particle i.  These are sorted so that
+// the neighbour list is the same as that from a search over all pairs.
+
+void CellList::neighbours(int i, vector<int>& nbrs) const
+{
+   nbrs.clear();
+
+   // cell coordinates of particle i
+   int ci[3];
+   ci[0] = cell[i] % ncell[0];
+   ci[1] = (cell[i] / ncell[0]) % ncell[1];
+   ci[2] = cell[i] / (ncell[0] * ncell[1]);
+
+   // adjacent cells; when there are fewer than 3 cells in a periodic
+   // direction the same cell can be reached twice, so skip duplicates
+   int adj[27];
+   int nadj = 0;
+   for (int dz = -1; dz != 2; ++dz) {
+      int cz = ci[2] + dz;
+      if (cz < 0 || cz >= ncell[2]) {
+         if (!periodic[2]) {
+            continue;
+         }
+         cz = (cz + ncell[2]) % ncell[2];
+      }
+      for (int dy = -1; dy != 2; ++dy) {
+         int cy = (ci[1] + dy + ncell[1]) % ncell[1];
+         for (int dx = -1; dx != 2; ++dx) {
+            int cx = (ci[0] + dx + ncell[0]) % ncell[0];
+            int c = (cz * ncell[1] + cy) * ncell[0] + cx;
+            if (std::find(adj, adj + nadj, c) == adj + nadj) {
+               adj[nadj++] = c;
+            }
+         }
+      }
+   }
+
+   const Particle& pi = particle(i);
+   double rsq;
+   for (int a = 0; a != nadj; ++a) {
+      for (int j = head[adj[a]]; j != -1; j = next[j]) {
+         if (j != i && box.isneigh(pi, particle(j), rsq)) {
+            nbrs.push_back(j);
+         }
+      }
+   }
+   std::sort(nbrs.begin(), nbrs.end());
+}
@@ -0,0 +1,65 @@
+#ifndef CELLLIST_H
+#define CELLLIST_H
+
+#include <vector>
+#include "particle.h"
+#include "box.h"
+
+// Linked-cell spatial index for finding neighbours.  The box is
+// divided into cells whose sides are at least the neighbour
+// separation, so the neighbours of a particle can only be in its own
+// cell or in one of the (up to) 26 adjacent cells.  This makes the
+// neighbour search O(N) rather than O(N^2).  Periodic boundaries are
+// handled in x and y, and in z only if the box is periodic in z.
+//
+// The index can be built either for all of the particles, or for a
+// subset of them given by pnums.  In the latter case, all particle
+// numbers used by the member functions are indices into pnums.  An
+// index can also be rebuilt with reset (e.g. for the next frame of a
+// trajectory), which reuses its storage.
+
+class CellList
+{
+public:
+   CellList() : allpars(0), pnums(0) { }
+   CellList(const std::vector<Particle>& particles, const Box& simbox);
+   CellList(const std::vector<Particle>& particles,
+            const std::vector<int>& pnums, const Box& simbox);
+
+   // rebuild the index for all of the particles
+   void reset(const std::vector<Particle>& particles, const Box& simbox);
+
+   // number of particles in the index
+   int size() const { return cell.size(); }
+
+   // indices of all neighbours of particle i, in ascending order
+   void neighbours(int i, std::vector<int>& nbrs) const;
+
+private:
+   void build(const Box& simbox);
+   void cellcoords(const double* pos, int* c) const;
+   inline const Particle& particle(int i) const;
+
+   const std::vector<Particle>* allpars;
+   const std::vector<int>* pnums;
+   Box box;
+
+   // number of cells and inverse cell width in each direction
+   int ncell[3];
+   double invwidth[3];
+   bool periodic[3];
+
+   // head[c] is the first particle in cell c, next[i] is the particle
+   // after i in the same cell (-1 terminates both), cell[i] is the
+   // cell containing particle i
+   std::vector<int> head;
+   std::vector<int> next;
+   std::vector<int> cell;
+};
+
+inline const Particle& CellList::particle(int i) const
+{
+   return pnums ? (*allpars)[(*pnums)[i]] : (*allpars)[i];
+}
+
+#endif
@@ -0,0 +1,155 @@
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include "neighbourlist.h"
+#include "threadpool.h"
+#include "clusters.h"
+
+using std::vector;
+using std::atomic;
+
+int Clusters::largest() const
+{
+   if (size.empty()) {
+      return -1;
+   }
+   return std::max_element(size.begin(), size.end()) - size.begin();
+}
+
+vector<int> Clusters::members(const int c) const
+{
+   vector<int> cnums;
+   if (c < 0) {
+      return cnums;
+   }
+   cnums.reserve(size[c]);
+   for (vector<int>::size_type i = 0; i != label.size(); ++i) {
+      if (label[i] == c) {
+         cnums.push_back(i);
+      }
+   }
+   return cnums;
+}
+
+// Root of the tree containing particle i.  In the forest every
+// particle points to one with a lower (or the same) index, so the root
+// is the lowest index in the cluster once all of the bonds have been
+// added.  Along the way, each particle visited is pointed at its
+// grandparent (path halving); this is safe to do concurrently since it
+// only ever lowers a parent index within the same tree.
+
+static int findroot(atomic<int>* parent, int i)
+{
+   for (;;) {
+      int p = parent[i].load(std::memory_order_relaxed);
+      if (p == i) {
+         return i;
+      }
+      int gp = parent[p].load(std::memory_order_relaxed);
+      if (gp != p) {
+         parent[i].compare_exchange_weak(p, gp, std::memory_order_relaxed);
+      }
+      i = gp;
+   }
+}
+
+// Merge the trees containing particles i and j, by pointing the root
+// with the higher index at the other.  The swap only succeeds if the
+// higher root is still a root, otherwise we try again.
+
+static void unite(atomic<int>* parent, int i, int j)
+{
+   for (;;) {
+      i = findroot(parent, i);
+      j = findroot(parent, j);
+      if (i == j) {
+         return;
+      }
+      if (i < j) {
+         std::swap(i, j);
+      }
+      int expected = i;
+      if (parent[i].compare_exchange_strong(expected, j, std::memory_order_relaxed)) {
+         return;
+      }
+   }
+}
+
+vector<Clusters> findclusters(const NeighbourList& nlist, const vector<unsigned char>& mask,
+                              const int nclass)
+{
+   vector<Clusters> clusters;
+   findclusters(nlist, mask, nclass, clusters);
+   return clusters;
+}
+
+void findclusters(const NeighbourList& nlist, const vector<unsigned char>& mask,
+                  const int nclass, vector<Clusters>& clusters)
+{
+   const int npar = nlist.size();
+
+   // one forest for each subset, each particle starts as its own root
+   std::unique_ptr<atomic<int>[]> parents(new atomic<int>[nclass * npar]);
+   threadpool().parallelfor(npar, PARCHUNK, [&](int begin, int end) {
+      for (int c = 0; c != nclass; ++c) {
+         for (int i = begin; i != end; ++i) {
+            parents[c * npar + i].store(i, std::memory_order_relaxed);
+         }
+      }
+   });
+
+   // add each bond (once) to the forest of each subset that contains
+   // both particles
+   threadpool().parallelfor(npar, PARCHUNK, [&](int begin, int end) {
+      for (int i = begin; i != end; ++i) {
+         if (mask[i] == 0) {
+            continue;
+         }
+         for (int k = nlist.offset[i]; k != nlist.offset[i + 1]; ++k) {
+            const int j = nlist.neigh[k];
+            const unsigned char both = mask[i] & mask[j];
+            if (j < i || both == 0) {
+               continue;
+            }
+            for (int c = 0; c != nclass; ++c) {
+               if (both & (1u << c)) {
+                  unite(&parents[c * npar], i, j);
+               }
+            }
+         }
+      }
+   });
+
+   clusters.resize(nclass);
+   for (int c = 0; c != nclass; ++c) {
+      atomic<int>* parent = &parents[c * npar];
+      vector<int>& label = clusters[c].label;
+      vector<int>& size = clusters[c].size;
+      label.assign(npar, -1);
+      size.clear();
+
+      // the roots, in ascending order, are the clusters
+      for (int i = 0; i != npar; ++i) {
+         if ((mask[i] & (1u << c)) && parent[i].load(std::memory_order_relaxed) == i) {
+            label[i] = size.size();
+            size.push_back(0);
+         }
+      }
+      threadpool().parallelfor(npar, PARCHUNK, [&](int begin, int end) {
+         for (int i = begin; i != end; ++i) {
+            if (mask[i] & (1u << c)) {
+               const int r = findroot(parent, i);
+               if (r != i) {
+                  label[i] = label[r];
+               }
+            }
+         }
+      });
+      for (int i = 0; i != npar; ++i) {
+         if (label[i] != -1) {
+            ++size[label[i]];
+         }
+      }
+   }
+}
@@ -0,0 +1,49 @@
+#ifndef CLUSTERS_H
+#define CLUSTERS_H
+
+#include <vector>
+#include "neighbourlist.h"
+
+// Clusters stores the clusters (connected components) of some subset
+// of the particles, e.g. the crystalline particles, where two
+// particles are connected if they are neighbours (see
+// psystem.nlist).  label[i] is the cluster that particle i belongs to,
+// or -1 if it is not in the subset, and size[c] is the number of
+// particles in cluster c.  The clusters are numbered in order of
+// their lowest particle index, so the labels don't depend on the
+// number of threads.
+
+struct Clusters
+{
+   // number of clusters
+   int num() const { return size.size(); }
+
+   // the largest cluster (the first one if there is a tie), -1 if
+   // there are no clusters
+   int largest() const;
+
+   // indices of the particles in cluster c, in ascending order (empty
+   // if c is -1)
+   std::vector<int> members(int c) const;
+
+   std::vector<int> label;
+   std::vector<int> size;
+};
+
+// Find the clusters for nclass different subsets of the particles at
+// once: particle i is in subset c if bit c of mask[i] is set.  This is
+// a single sweep over the neighbour list, with a disjoint-set forest
+// (union-find) for each subset; with more than one thread, the bonds
+// are shared between the threads and the forests are updated with
+// atomic compare-and-swap rather than locks.
+
+std::vector<Clusters> findclusters(const NeighbourList&, const std::vector<unsigned char>&,
+                                   int);
+
+// The same, but the result is stored in clusters, reusing the storage
+// of its elements (e.g. the clusters of the previous frame).
+
+void findclusters(const NeighbourList&, const std::vector<unsigned char>&, int,
+                  std::vector<Clusters>&);
+
+#endif
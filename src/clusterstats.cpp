@@ -0,0 +1,179 @@
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+#include "particlesystem.h"
+#include "neighbourlist.h"
+#include "threadpool.h"
+#include "gtensor.h"
+#include "clusters.h"
+#include "qdata.h"
+#include "qlmarray.h"
+#include "diagonalize.h"
+#include "constants.h"
+#include "clusterstats.h"
+
+using std::vector;
+using std::complex;
+using std::endl;
+
+// Q of a cluster from the sum of qlm(i) over its particles (the same
+// as Qpars, with the sum already done).
+
+static double qfromsum(const complex<double>* qsum, const int lval, const int size)
+{
+   double qvalue = 0.0;
+   for (int m = 0; m != lval + 1; ++m) {
+      qvalue += mweight(m) * norm(qsum[m] / static_cast<double>(size));
+   }
+   return sqrt(qvalue * (4.0 * PI / (2 * lval + 1)));
+}
+
+vector<ClusterStats> clusterstats(const ParticleSystem& psystem, const Clusters& clusters,
+                                  const vector<LDCLASS>& ldclass, const QData& q6data,
+                                  const QData& q4data)
+{
+   const vector<int>& label = clusters.label;
+   const int npar = label.size();
+   const int ncl = clusters.num();
+   const int l6 = q6data.lval;
+   const int l4 = q4data.lval;
+
+   // the particles of each cluster in ascending order, members[k] for
+   // first[c] <= k < first[c + 1] (a counting sort of the labels)
+   vector<int> first(ncl + 1, 0);
+   for (int i = 0; i != npar; ++i) {
+      if (label[i] != -1) {
+         ++first[label[i] + 1];
+      }
+   }
+   for (int c = 0; c != ncl; ++c) {
+      first[c + 1] += first[c];
+   }
+   vector<int> members(first[ncl]);
+   vector<int> next(first.begin(), first.end() - 1);
+   for (int i = 0; i != npar; ++i) {
+      if (label[i] != -1) {
+         members[next[label[i]]++] = i;
+      }
+   }
+
+   // remove the periodic boundary conditions from each cluster (see
+   // unwrapcluster in gtensor.cpp), and add up the position r of each
+   // particle relative to the first particle of its cluster, and r r,
+   // for the gyration tensor.  The clusters are independent, so they
+   // are shared between the threads (a few at a time, since most
+   // clusters are small).
+   vector<char> percolates(3 * ncl, 0);
+   vector<double> rsum(3 * ncl, 0.0);
+   vector<double> rrsum(9 * ncl, 0.0);
+   threadpool().parallelfor(ncl, 16, [&](int begin, int end) {
+      vector<int> cnums;
+      vector<int> image;
+      for (int c = begin; c != end; ++c) {
+         cnums.assign(members.begin() + first[c], members.begin() + first[c + 1]);
+         bool perc[3];
+         unwrapcluster(psystem, cnums, image, perc);
+         const double* r0 = psystem.allpars[cnums[0]].pos;
+         for (vector<int>::size_type i = 0; i != cnums.size(); ++i) {
+            const double* pos = psystem.allpars[cnums[i]].pos;
+            double r[3];
+            for (int d = 0; d != 3; ++d) {
+               r[d] = pos[d] + image[3 * i + d] * psystem.simbox.length(d) - r0[d];
+            }
+            for (int d = 0; d != 3; ++d) {
+               rsum[3 * c + d] += r[d];
+               for (int e = 0; e != 3; ++e) {
+                  rrsum[9 * c + 3 * d + e] += r[d] * r[e];
+               }
+            }
+         }
+         for (int d = 0; d != 3; ++d) {
+            percolates[3 * c + d] = perc[d];
+         }
+      }
+   });
+
+   // accumulate everything for each cluster in one pass over the
+   // particles (in ascending order, so the qlm sums are done in the
+   // same order as for Qpars)
+   vector<int> counts(6 * ncl, 0);
+   vector<complex<double> > q6sum((l6 + 1) * ncl, 0.0);
+   vector<complex<double> > q4sum((l4 + 1) * ncl, 0.0);
+   for (int i = 0; i != npar; ++i) {
+      const int c = label[i];
+      if (c == -1) {
+         continue;
+      }
+      ++counts[6 * c + ldclass[i]];
+      for (int m = 0; m != l6 + 1; ++m) {
+         q6sum[(l6 + 1) * c + m] += q6data.qlm(i, m);
+      }
+      for (int m = 0; m != l4 + 1; ++m) {
+         q4sum[(l4 + 1) * c + m] += q4data.qlm(i, m);
+      }
+   }
+
+   // gyration tensor of each cluster is <r r> - <r><r>
+   vector<double> gyt(9 * ncl);
+   for (int c = 0; c != ncl; ++c) {
+      const double size = clusters.size[c];
+      for (int d = 0; d != 3; ++d) {
+         for (int e = 0; e != 3; ++e) {
+            gyt[9 * c + 3 * d + e] = rrsum[9 * c + 3 * d + e] / size
+                                     - (rsum[3 * c + d] / size) * (rsum[3 * c + e] / size);
+         }
+      }
+   }
+   vector<double> vecs(9 * ncl);
+   vector<double> eigs(3 * ncl);
+   diagonalizemany(gyt.data(), 3, ncl, vecs.data(), eigs.data());
+
+   vector<ClusterStats> stats(ncl);
+   for (int c = 0; c != ncl; ++c) {
+      ClusterStats& s = stats[c];
+      s.size = clusters.size[c];
+      s.nfcc = static_cast<double>(counts[6 * c + FCC]) / s.size;
+      s.nhcp = static_cast<double>(counts[6 * c + HCP]) / s.size;
+      s.nbcc = static_cast<double>(counts[6 * c + BCC]) / s.size;
+      s.nicos = static_cast<double>(counts[6 * c + ICOS]) / s.size;
+      s.q6 = qfromsum(&q6sum[(l6 + 1) * c], l6, s.size);
+      s.q4 = qfromsum(&q4sum[(l4 + 1) * c], l4, s.size);
+      for (int d = 0; d != 3; ++d) {
+         s.eig[d] = eigs[3 * c + d];
+         s.percolates[d] = percolates[3 * c + d];
+      }
+   }
+
+   return stats;
+}
+
+void printclusterstats(std::ostream& out, const vector<ClusterStats>& stats)
+{
+   // largest cluster first (and in order of label for equal sizes)
+   vector<int> order(stats.size());
+   for (vector<int>::size_type c = 0; c != order.size(); ++c) {
+      order[c] = c;
+   }
+   std::stable_sort(order.begin(), order.end(),
+                    [&](int a, int b) { return stats[a].size > stats[b].size; });
+
+   out << "# cluster size n_fcc n_hcp n_bcc n_icos Q6 Q4 "
+       << "Rbar_g,1 Rbar_g,2 Rbar_g,3 percolates" << endl;
+   const char dims[] = {'x', 'y', 'z'};
+   for (vector<int>::size_type n = 0; n != order.size(); ++n) {
+      const ClusterStats& s = stats[order[n]];
+      out << order[n] << " " << s.size << " " << s.nfcc << " " << s.nhcp << " "
+          << s.nbcc << " " << s.nicos << " " << s.q6 << " " << s.q4 << " "
+          << s.eig[0] << " " << s.eig[1] << " " << s.eig[2] << " ";
+      bool any = false;
+      for (int d = 0; d != 3; ++d) {
+         if (s.percolates[d]) {
+            out << dims[d];
+            any = true;
+         }
+      }
+      out << (any ? "" : "-") << endl;
+   }
+}
@@ -0,0 +1,54 @@
+#ifndef CLUSTERSTATS_H
+#define CLUSTERSTATS_H
+
+#include <vector>
+#include <iostream>
+#include "particlesystem.h"
+#include "clusters.h"
+#include "qdata.h"
+#include "constants.h"
+
+// ClusterStats stores the size, composition and shape of a single
+// cluster, i.e. the same quantities that are output for the largest
+// cluster (see main.cpp), so that the cluster size distribution and
+// the properties of every cluster can be found from one run.
+
+struct ClusterStats
+{
+   // number of particles
+   int size;
+
+   // fraction of fcc, hcp, bcc and icosahedral particles (by the LD
+   // classification)
+   double nfcc;
+   double nhcp;
+   double nbcc;
+   double nicos;
+
+   // Q6 and Q4 of the cluster
+   double q6;
+   double q4;
+
+   // eigenvalues of the gyration tensor, smallest first
+   double eig[3];
+
+   // whether the cluster is connected to its own periodic image in
+   // the x, y and z directions
+   bool percolates[3];
+};
+
+// Statistics for every cluster in clusters, element c of the result is
+// for cluster c.  This is a single pass over the cluster labels with
+// an accumulator for each cluster (rather than e.g. a GTensor for each
+// cluster), and the gyration tensors are diagonalised together.
+
+std::vector<ClusterStats> clusterstats(const ParticleSystem&, const Clusters&,
+                                       const std::vector<LDCLASS>&, const QData&,
+                                       const QData&);
+
+// Write the statistics as a table with one line per cluster, largest
+// cluster first.
+
+void printclusterstats(std::ostream&, const std::vector<ClusterStats>&);
+
+#endif
@@ -1,7 +1,12 @@
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
 
-const double PI = 3.14159265358979;
+constexpr double PI = 3.14159265358979;
+
+// The qlm functions are templates on l (see qlmfunctions.h), and
+// QData can be constructed for 0 <= l <= MAXL.
+
+const int MAXL = 12;
 
 // Classification constants for Lechner Dellago (LD)
 // and Ten-Wolde Frenkel (TF) criterion.  For LD, we classify
@@ -27,7 +32,7 @@ enum TFCLASS {LIQ, XTAL, SURF};
 //  distinct permutations (including m1 m2 m3 and -m1 -m2 -m3).
 
 // for l = 6 there are 16 different values
-const double WIGNER6[] = { 0.0511827,  //6 -6  0 (6)
+constexpr double WIGNER6[] = { 0.0511827,  //6 -6  0 (6)
                           -0.0957541,  //6 -5 -1 (12)
                            0.129115,   //6 -4 -2 (12)
                           -0.141438,   //6 -3 -3 (6)
@@ -44,7 +49,7 @@ const double WIGNER6[] = { 0.0511827,  //6 -6  0 (6)
                            0.0465298,  //1 -1  0 (6)
                           -0.0930595   //0  0  0 (1)
 };
-const int WIGNERINDX6[16][3] = { {6, -6, 0},
+constexpr int WIGNERINDX6[16][3] = { {6, -6, 0},
                                  {6, -5, -1},
                                  {6, -4, -2},
                                  {6, -3, -3},
@@ -61,10 +66,10 @@ const int WIGNERINDX6[16][3] = { {6, -6, 0},
                                  {1, -1, 0},
                                  {0, 0, 0}
 };
-const int WIGNERPERM6[] = {6, 12, 12, 6, 6, 12, 12, 6, 12, 6, 6, 12, 6, 6, 6, 1};
+constexpr int WIGNERPERM6[] = {6, 12, 12, 6, 6, 12, 12, 6, 12, 6, 6, 12, 6, 6, 6, 1};
      
 // for l = 4 there are 9 different values
-const double WIGNER4[] = { 0.104298,   // 4 -4  0 (6)
+constexpr double WIGNER4[] = { 0.104298,   // 4 -4  0 (6)
                           -0.164909,   // 4 -3 -1 (12)
                            0.186989,   // 4 -2 -2 (6)
                            0.156447,   // 3 -3  0 (6)
@@ -74,7 +79,7 @@ const double WIGNER4[] = { 0.104298,   // 4 -4  0 (6)
                           -0.0670485,  // 1 -1  0 (6)
                            0.134097,   // 0  0  0 (1)
 };
-const int WIGNERINDX4[9][3] = { {4, -4,  0},
+constexpr int WIGNERINDX4[9][3] = { {4, -4,  0},
                                 {4, -3, -1},
                                 {4, -2, -2},
                                 {3, -3,  0},
@@ -84,6 +89,6 @@ const int WIGNERINDX4[9][3] = { {4, -4,  0},
                                 {1, -1,  0},
                                 {0,  0,  0},
 };
-const int WIGNERPERM4[] = {6, 12, 6, 6, 12, 6, 6, 6, 1};
+constexpr int WIGNERPERM4[] = {6, 12, 6, 6, 12, 6, 6, 6, 1};
 
 #endif
@@ -0,0 +1,286 @@
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include "decompress.h"
+
+using std::string;
+using std::vector;
+using std::endl;
+
+// Size of the blocks of compressed data read from the file and of
+// decompressed data passed to the reader, and number of decompressed
+// blocks that the decompression thread can be ahead by.
+
+static const int BLOCKSIZE = 1 << 20;
+static const int NBLOCKSAHEAD = 4;
+
+COMPRESSION compression(const string& fname)
+{
+   unsigned char magic[6] = {0, 0, 0, 0, 0, 0};
+   std::ifstream infile(fname.c_str(), std::ios::binary);
+   infile.read(reinterpret_cast<char*>(magic), sizeof(magic));
+   if (magic[0] == 0x1f && magic[1] == 0x8b) {
+      return GZIP;
+   }
+   if (magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+      return ZSTD;
+   }
+   if (magic[0] == 0xfd && memcmp(magic + 1, "7zXZ", 4) == 0 && magic[5] == 0) {
+      return XZ;
+   }
+   return NOCOMPRESSION;
+}
+
+bool supported(COMPRESSION type)
+{
+   switch (type) {
+#ifdef HAVE_ZLIB
+   case GZIP:
+      return true;
+#endif
+#ifdef HAVE_LZMA
+   case XZ:
+      return true;
+#endif
+#ifdef HAVE_ZSTD
+   case ZSTD:
+      return true;
+#endif
+   case NOCOMPRESSION:
+      return true;
+   default:
+      return false;
+   }
+}
+
+DecompressBuf::DecompressBuf(const string& _fname, COMPRESSION _type)
+   : fname(_fname), type(_type), blocks(NBLOCKSAHEAD)
+{
+   setg(0, 0, 0);
+   thread = std::thread([this]() { decompress(); });
+}
+
+DecompressBuf::~DecompressBuf()
+{
+   // if the reader stops early, this stops the decompression thread
+   blocks.close();
+   thread.join();
+}
+
+DecompressBuf::int_type DecompressBuf::underflow()
+{
+   if (gptr() < egptr()) {
+      return traits_type::to_int_type(*gptr());
+   }
+   do {
+      if (!blocks.pop(block)) {
+         // the decompression thread has finished, so error can be read
+         if (!error.empty()) {
+            warning = "Warning: " + fname + " " + error;
+            error.clear();
+         }
+         return traits_type::eof();
+      }
+   } while (block.empty());
+   setg(&block[0], &block[0], &block[0] + block.size());
+   return traits_type::to_int_type(*gptr());
+}
+
+string DecompressBuf::takewarning()
+{
+   string w;
+   w.swap(warning);
+   return w;
+}
+
+// Decompress the file into blocks.  This runs on the decompression
+// thread; if the data is corrupt, error is set (and the reader is
+// warned when it gets to the end of the data, see takewarning).
+
+void DecompressBuf::decompress()
+{
+   std::FILE* file = std::fopen(fname.c_str(), "rb");
+   vector<char> in(BLOCKSIZE);
+   string out(BLOCKSIZE, '\0');
+   bool ok = (file != 0);
+   bool stopped = false;
+   size_t nin = 0;
+   bool eof = false;
+
+   // read the next block of compressed data into in, returns the
+   // number of bytes read (these two are unused in a build without
+   // any of the libraries)
+   [[maybe_unused]] auto readin = [&]() {
+      nin = ok ? std::fread(in.data(), 1, in.size(), file) : 0;
+      eof = (nin == 0);
+      return nin;
+   };
+   // pass the decompressed data in out[0, nout) to the reader
+   [[maybe_unused]] auto writeout = [&](size_t nout) {
+      if (nout != 0) {
+         string data(out, 0, nout);
+         stopped = stopped || !blocks.push(std::move(data));
+      }
+   };
+
+   if (type == GZIP) {
+#ifdef HAVE_ZLIB
+      // a gzip file can have several members one after the other.
+      // More input is only read once all of the output for the input
+      // so far has been passed on (i.e. out wasn't filled)
+      z_stream zs;
+      memset(&zs, 0, sizeof(zs));
+      ok = ok && inflateInit2(&zs, 15 + 16) == Z_OK;
+      bool outfull = false;
+      bool atend = false;
+      while (ok && !stopped) {
+         if (zs.avail_in == 0 && !outfull) {
+            zs.avail_in = readin();
+            zs.next_in = reinterpret_cast<Bytef*>(in.data());
+            if (eof) {
+               break;
+            }
+         }
+         zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+         zs.avail_out = out.size();
+         const int ret = inflate(&zs, Z_NO_FLUSH);
+         outfull = (zs.avail_out == 0);
+         writeout(out.size() - zs.avail_out);
+         if (ret == Z_STREAM_END) {
+            inflateReset(&zs);
+            atend = true;
+         }
+         else if (ret == Z_OK) {
+            atend = false;
+         }
+         else if (ret != Z_BUF_ERROR) {
+            ok = false;
+         }
+      }
+      if (ok && !stopped && !atend) {
+         error = "ends part way through the compressed data.";
+      }
+      inflateEnd(&zs);
+#endif
+   }
+   else if (type == XZ) {
+#ifdef HAVE_LZMA
+      // LZMA_CONCATENATED also reads several xz streams one after the
+      // other
+      lzma_stream ls = LZMA_STREAM_INIT;
+      ok = ok && lzma_stream_decoder(&ls, UINT64_MAX, LZMA_CONCATENATED) == LZMA_OK;
+      lzma_action action = LZMA_RUN;
+      lzma_ret ret = LZMA_OK;
+      while (ok && !stopped && ret != LZMA_STREAM_END) {
+         if (ls.avail_in == 0 && action == LZMA_RUN) {
+            ls.avail_in = readin();
+            ls.next_in = reinterpret_cast<const uint8_t*>(in.data());
+            action = eof ? LZMA_FINISH : LZMA_RUN;
+         }
+         ls.next_out = reinterpret_cast<uint8_t*>(&out[0]);
+         ls.avail_out = out.size();
+         ret = lzma_code(&ls, action);
+         writeout(out.size() - ls.avail_out);
+         ok = (ret == LZMA_OK || ret == LZMA_STREAM_END);
+      }
+      lzma_end(&ls);
+#endif
+   }
+   else if (type == ZSTD) {
+#ifdef HAVE_ZSTD
+      // a zstd file can have several frames one after the other (as
+      // for gzip, more input is only read once out isn't filled)
+      ZSTD_DCtx* dctx = ZSTD_createDCtx();
+      ZSTD_inBuffer zin = {in.data(), 0, 0};
+      size_t ret = 0;
+      bool outfull = false;
+      ok = ok && dctx != 0;
+      while (ok && !stopped) {
+         if (zin.pos == zin.size && !outfull) {
+            zin.size = readin();
+            zin.pos = 0;
+            if (eof) {
+               break;
+            }
+         }
+         ZSTD_outBuffer zout = {&out[0], out.size(), 0};
+         ret = ZSTD_decompressStream(dctx, &zout, &zin);
+         ok = !ZSTD_isError(ret);
+         outfull = (zout.pos == zout.size);
+         writeout(zout.pos);
+      }
+      if (ok && !stopped && ret != 0) {
+         error = "ends part way through the compressed data.";
+      }
+      ZSTD_freeDCtx(dctx);
+#endif
+   }
+
+   if (!ok && file && !stopped && error.empty()) {
+      error = "is corrupt, could not decompress all of it.";
+   }
+   if (file) {
+      std::fclose(file);
+   }
+   blocks.close();
+}
+
+// An istream that owns its DecompressBuf.
+
+class DecompressStream : public std::istream
+{
+public:
+   DecompressStream(const string& fname, COMPRESSION type)
+      : std::istream(0), buf(fname, type)
+   {
+      rdbuf(&buf);
+   }
+
+private:
+   DecompressBuf buf;
+};
+
+std::unique_ptr<std::istream> openinput(const string& fname, std::ostream& warn)
+{
+   std::unique_ptr<std::istream> in;
+   const COMPRESSION type = compression(fname);
+   if (!std::ifstream(fname.c_str())) {
+      warn << "Warning: " << fname
+           << " does not exist or cannot be read." << endl;
+   }
+   else if (!supported(type)) {
+      warn << "Warning: " << fname << " is compressed in a format that this build"
+           << " can't read (see the Makefile)." << endl;
+   }
+   else if (type == NOCOMPRESSION) {
+      in.reset(new std::ifstream(fname.c_str(), std::ios::binary));
+   }
+   else {
+      in.reset(new DecompressStream(fname, type));
+   }
+   return in;
+}
+
+void inputwarnings(std::istream& in, std::ostream& warn)
+{
+   DecompressBuf* buf = dynamic_cast<DecompressBuf*>(in.rdbuf());
+   if (buf) {
+      const string w = buf->takewarning();
+      if (!w.empty()) {
+         warn << w << endl;
+      }
+   }
+}
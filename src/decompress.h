@@ -0,0 +1,70 @@
+#ifndef DECOMPRESS_H
+#define DECOMPRESS_H
+
+#include <string>
+#include <istream>
+#include <iostream>
+#include <streambuf>
+#include <thread>
+#include <memory>
+#include "boundedqueue.h"
+
+// Compressed input files are detected from their first few bytes (the
+// file name doesn't matter).  Each format can only be read if the code
+// was built with the library for it (see the Makefile).
+
+enum COMPRESSION {NOCOMPRESSION, GZIP, ZSTD, XZ};
+
+COMPRESSION compression(const std::string&);
+
+// Can the code read files compressed with the given type?
+
+bool supported(COMPRESSION);
+
+// Streambuf for reading a compressed file.  The file is decompressed
+// on a separate thread, which stays a few blocks ahead of the reader,
+// so that decompression and e.g. parsing and analysis of the frames
+// already read happen at the same time.
+
+class DecompressBuf : public std::streambuf
+{
+public:
+   DecompressBuf(const std::string&, COMPRESSION);
+   ~DecompressBuf();
+
+   // the warning if the reader has got to the end of the data and it
+   // is truncated or corrupt (empty otherwise), which is only returned
+   // once
+   std::string takewarning();
+
+protected:
+   int_type underflow();
+
+private:
+   void decompress();
+
+   std::string fname;
+   COMPRESSION type;
+   BoundedQueue<std::string> blocks;
+   std::string block;
+   std::string error;
+   std::string warning;
+   std::thread thread;
+};
+
+// Open fname for reading: this is an ifstream for an uncompressed file,
+// or reads through a DecompressBuf for a compressed one.  Returns null
+// (with a warning, written to warn) if the file can't be read, or it
+// is compressed in a format the code was built without.
+
+std::unique_ptr<std::istream> openinput(const std::string&, std::ostream& warn = std::cout);
+
+// Write the warning for an input opened by openinput to warn, if the
+// reader has got to the end of it and the compressed data is truncated
+// or corrupt (see DecompressBuf::takewarning).  The readers call this
+// when they get to the end of the input, so that the warning goes with
+// the warnings for the frame being read.
+
+void inputwarnings(std::istream&, std::ostream& warn);
+
+#endif
@@ -1,39 +1,245 @@
 #include <iostream>
-#include <gsl/gsl_math.h>
-#include <gsl/gsl_eigen.h>
-#include "boost/multi_array.hpp"
+#include <cmath>
+#include <utility>
+#include "constants.h"
+#include "threadpool.h"
+#include "diagonalize.h"
 
 using std::cout;
 using std::endl;
+using std::sqrt;
+using std::fabs;
 
-// Diagonalize real symmetric matrix, which is represented as an
-// array.  Note that here we are using gsl - GNU Scientific Library -
-// for diagonalisation.
+// Diagonalize real symmetric matrix by cyclic Jacobi rotations.  This
+// works for any dim, and is used for 3x3 matrices with (nearly)
+// degenerate eigenvalues, where the closed form eigenvectors below
+// are not accurate.  Eigenvalues are returned in eig (unsorted) and
+// the eigenvectors as the columns of res.
 
-void diagonalize(double* data, const int dim, double* res, double* eig)
+static void jacobi(const double* data, const int dim, double* res, double* eig)
 {
-   gsl_matrix_view m = gsl_matrix_view_array (data, dim, dim);
-   gsl_vector *eval = gsl_vector_alloc (dim);
-   gsl_matrix *evec = gsl_matrix_alloc (dim, dim);
-   gsl_eigen_symmv_workspace * w = gsl_eigen_symmv_alloc (dim);
-   gsl_eigen_symmv (&m.matrix, eval, evec, w);
-   gsl_eigen_symmv_free (w);
-   gsl_eigen_symmv_sort (eval, evec, GSL_EIGEN_SORT_ABS_ASC);
-   
+   double a[9];
+   for (int i = 0; i != dim * dim; ++i) {
+      a[i] = data[i];
+      res[i] = (i % (dim + 1) == 0) ? 1.0 : 0.0;
+   }
+
+   for (int sweep = 0; sweep != 50; ++sweep) {
+      double off = 0.0;
+      double diag = 0.0;
+      for (int p = 0; p != dim; ++p) {
+         diag += a[p * dim + p] * a[p * dim + p];
+         for (int q = p + 1; q != dim; ++q) {
+            off += a[p * dim + q] * a[p * dim + q];
+         }
+      }
+      if (off <= 1.0e-30 * diag || off == 0.0) {
+         break;
+      }
+      for (int p = 0; p != dim; ++p) {
+         for (int q = p + 1; q != dim; ++q) {
+            if (a[p * dim + q] == 0.0) {
+               continue;
+            }
+            // rotation that zeroes a[p][q]
+            const double theta = (a[q * dim + q] - a[p * dim + p]) / (2.0 * a[p * dim + q]);
+            const double t = ((theta >= 0.0) ? 1.0 : -1.0)
+                             / (fabs(theta) + sqrt(theta * theta + 1.0));
+            const double c = 1.0 / sqrt(t * t + 1.0);
+            const double s = t * c;
+            for (int k = 0; k != dim; ++k) {
+               const double akp = a[k * dim + p];
+               const double akq = a[k * dim + q];
+               a[k * dim + p] = c * akp - s * akq;
+               a[k * dim + q] = s * akp + c * akq;
+            }
+            for (int k = 0; k != dim; ++k) {
+               const double apk = a[p * dim + k];
+               const double aqk = a[q * dim + k];
+               a[p * dim + k] = c * apk - s * aqk;
+               a[q * dim + k] = s * apk + c * aqk;
+            }
+            for (int k = 0; k != dim; ++k) {
+               const double vkp = res[k * dim + p];
+               const double vkq = res[k * dim + q];
+               res[k * dim + p] = c * vkp - s * vkq;
+               res[k * dim + q] = s * vkp + c * vkq;
+            }
+         }
+      }
+   }
+
    for (int i = 0; i != dim; ++i) {
-      double eval_i = gsl_vector_get (eval, i);
-      gsl_vector_view evec_i = gsl_matrix_column (evec, i);
+      eig[i] = a[i * dim + i];
+   }
+}
+
+// Eigenvalues and eigenvectors of a 2x2 symmetric matrix, in closed
+// form.  The rotation angle is computed with atan2, which is stable
+// whatever the size of the off diagonal element.
+
+static void diagonalize2(const double* data, double* res, double* eig)
+{
+   const double a = data[0];
+   const double b = 0.5 * (data[1] + data[2]);
+   const double d = data[3];
+
+   const double mean = 0.5 * (a + d);
+   const double half = 0.5 * (a - d);
+   const double rad = sqrt(half * half + b * b);
+   const double theta = 0.5 * atan2(2.0 * b, a - d);
+   const double c = cos(theta);
+   const double s = sin(theta);
+
+   // (c, s) is the eigenvector of mean + rad, (-s, c) of mean - rad
+   eig[0] = mean + rad;
+   eig[1] = mean - rad;
+   res[0] = c;
+   res[2] = s;
+   res[1] = -s;
+   res[3] = c;
+}
+
+// Eigenvalues of a 3x3 symmetric matrix, in closed form (trigonometric
+// solution of the characteristic cubic, see O. K. Smith, Comm. ACM 4,
+// 168 (1961)), and eigenvectors from cross products of the rows of
+// A - lambda I.  Falls back to Jacobi rotations when two eigenvalues
+// are (nearly) equal.
+
+static void diagonalize3(const double* data, double* res, double* eig)
+{
+   const double a00 = data[0];
+   const double a11 = data[4];
+   const double a22 = data[8];
+   const double a01 = 0.5 * (data[1] + data[3]);
+   const double a02 = 0.5 * (data[2] + data[6]);
+   const double a12 = 0.5 * (data[5] + data[7]);
+
+   const double p1 = a01 * a01 + a02 * a02 + a12 * a12;
+   const double q = (a00 + a11 + a22) / 3.0;
+   const double p2 = (a00 - q) * (a00 - q) + (a11 - q) * (a11 - q)
+                     + (a22 - q) * (a22 - q) + 2.0 * p1;
+   const double p = sqrt(p2 / 6.0);
+   if (p == 0.0 || p1 == 0.0) {
+      // diagonal matrix (or a multiple of the identity)
+      jacobi(data, 3, res, eig);
+      return;
+   }
+
+   // B = (A - qI) / p, and r = det(B) / 2, which is in [-1, 1]
+   const double b00 = (a00 - q) / p;
+   const double b11 = (a11 - q) / p;
+   const double b22 = (a22 - q) / p;
+   const double b01 = a01 / p;
+   const double b02 = a02 / p;
+   const double b12 = a12 / p;
+   const double r = 0.5 * (b00 * (b11 * b22 - b12 * b12) - b01 * (b01 * b22 - b12 * b02)
+                           + b02 * (b01 * b12 - b11 * b02));
+   const double phi = (r <= -1.0) ? PI / 3.0 : ((r >= 1.0) ? 0.0 : acos(r) / 3.0);
+
+   // largest, smallest, and middle eigenvalue
+   eig[0] = q + 2.0 * p * cos(phi);
+   eig[2] = q + 2.0 * p * cos(phi + 2.0 * PI / 3.0);
+   eig[1] = 3.0 * q - eig[0] - eig[2];
 
-      // res stores eigenvectors as columns
-      for (int j = 0; j < dim; ++j) {
-         res[i + dim * j] = gsl_vector_get(&evec_i.vector, j);
+   // the eigenvectors are only well determined if the eigenvalues are
+   // well separated (relative to the spread p)
+   if (eig[0] - eig[1] < 1.0e-3 * p || eig[1] - eig[2] < 1.0e-3 * p) {
+      jacobi(data, 3, res, eig);
+      return;
+   }
+
+   for (int i = 0; i != 3; ++i) {
+      const double r0[3] = {a00 - eig[i], a01, a02};
+      const double r1[3] = {a01, a11 - eig[i], a12};
+      const double r2[3] = {a02, a12, a22 - eig[i]};
+      // the eigenvector is orthogonal to every row, so is parallel to
+      // the cross product of any two; take the largest of these
+      const double* rows[3][2] = {{r0, r1}, {r0, r2}, {r1, r2}};
+      double best[3] = {0.0, 0.0, 0.0};
+      double bestnorm = 0.0;
+      for (int c = 0; c != 3; ++c) {
+         const double* u = rows[c][0];
+         const double* v = rows[c][1];
+         const double x[3] = {u[1] * v[2] - u[2] * v[1],
+                              u[2] * v[0] - u[0] * v[2],
+                              u[0] * v[1] - u[1] * v[0]};
+         const double norm = x[0] * x[0] + x[1] * x[1] + x[2] * x[2];
+         if (norm > bestnorm) {
+            bestnorm = norm;
+            best[0] = x[0];
+            best[1] = x[1];
+            best[2] = x[2];
+         }
+      }
+      if (bestnorm == 0.0) {
+         jacobi(data, 3, res, eig);
+         return;
+      }
+      const double inv = 1.0 / sqrt(bestnorm);
+      for (int j = 0; j != 3; ++j) {
+         res[i + 3 * j] = best[j] * inv;
+      }
+   }
+}
+
+// Diagonalize real symmetric matrix (dim = 2 or 3), which is
+// represented as an array.  After the call, eig stores the
+// eigenvalues in ascending order of absolute value, and res the
+// corresponding eigenvectors as columns (the same as the GSL routines
+// that were used before, with GSL_EIGEN_SORT_ABS_ASC).  No memory is
+// allocated.
+
+void diagonalize(const double* data, const int dim, double* res, double* eig)
+{
+   double vec[9];
+   double val[3];
+   if (dim == 2) {
+      diagonalize2(data, vec, val);
+   }
+   else if (dim == 3) {
+      diagonalize3(data, vec, val);
+   }
+   else {
+      cout << "Error: diagonalize is only for 2x2 and 3x3 matrices" << endl;
+      return;
+   }
+
+   // sort into ascending order of absolute value, with a
+   // compare-and-swap network for 2 or 3 elements (equal values keep
+   // their order)
+   int order[3] = {0, 1, 2};
+   auto cswap = [&](int a, int b) {
+      if (fabs(val[order[b]]) < fabs(val[order[a]])) {
+         std::swap(order[a], order[b]);
       }
-      // eig stores eigenvalues
-      eig[i] = eval_i;
+   };
+   cswap(0, 1);
+   if (dim == 3) {
+      cswap(1, 2);
+      cswap(0, 1);
    }
+   for (int i = 0; i != dim; ++i) {
+      eig[i] = val[order[i]];
+      for (int j = 0; j != dim; ++j) {
+         res[i + dim * j] = vec[order[i] + dim * j];
+      }
+   }
+}
+
+// Diagonalize nmat matrices at once: matrix n is data[n * dim * dim],
+// and its results are in res[n * dim * dim] and eig[n * dim].  The
+// matrices are shared between the threads.
 
-   gsl_vector_free (eval);
-   gsl_matrix_free (evec);
+void diagonalizemany(const double* data, const int dim, const int nmat, double* res,
+                     double* eig)
+{
+   const int dsq = dim * dim;
+   threadpool().parallelfor(nmat, PARCHUNK, [&](int begin, int end) {
+      for (int n = begin; n != end; ++n) {
+         diagonalize(data + n * dsq, dim, res + n * dsq, eig + n * dim);
+      }
+   });
 }
 
 // Print eigenvalue information.
@@ -1,7 +1,12 @@
 #ifndef DIAGONALIZE_H
 #define DIAGONALIZE_H
 
-void diagonalize(double*, const int, double*, double*);
+// Eigenvalues and eigenvectors of real symmetric 2x2 and 3x3 matrices
+// (e.g. the gyration tensor), see diagonalize.cpp.  The eigenvalues
+// are sorted in ascending order of absolute value.
+
+void diagonalize(const double*, const int, double*, double*);
+void diagonalizemany(const double*, const int, const int, double*, double*);
 void printeig(const double*, const double*, const int);
 
 #endif
@@ -0,0 +1,231 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <charconv>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "readwrite.h"
+#include "frameindex.h"
+
+using std::string;
+using std::vector;
+using std::cout;
+using std::endl;
+
+static const char INDEXMAGIC[8] = {'O', 'P', 'F', 'I', 'D', 'X', '\0', '\0'};
+static const int INDEXVERSION = 1;
+
+// Read the sidecar file idxfile into index, returns false if there is
+// no (valid) sidecar file.
+
+static bool readindex(const string& idxfile, FrameIndex& index)
+{
+   std::FILE* file = std::fopen(idxfile.c_str(), "rb");
+   if (!file) {
+      return false;
+   }
+   char magic[sizeof(INDEXMAGIC)];
+   std::int64_t head[4]; // version, end, endline, number of frames
+   bool ok = std::fread(magic, sizeof(magic), 1, file) == 1
+             && memcmp(magic, INDEXMAGIC, sizeof(magic)) == 0
+             && std::fread(head, sizeof(head), 1, file) == 1
+             && head[0] == INDEXVERSION && head[3] >= 0;
+   if (ok) {
+      vector<std::int64_t> entries(3 * head[3]);
+      ok = std::fread(entries.data(), sizeof(std::int64_t), entries.size(), file)
+           == entries.size();
+      index.end = head[1];
+      index.endline = head[2];
+      index.offset.resize(head[3]);
+      index.line.resize(head[3]);
+      index.npar.resize(head[3]);
+      for (long k = 0; k != head[3]; ++k) {
+         index.offset[k] = entries[3 * k];
+         index.line[k] = entries[3 * k + 1];
+         index.npar[k] = entries[3 * k + 2];
+      }
+   }
+   std::fclose(file);
+   if (!ok) {
+      index = FrameIndex();
+   }
+   return ok;
+}
+
+// Write index to the sidecar file idxfile (to a temporary file first,
+// so that the sidecar file is always complete).
+
+static bool writeindex(const string& idxfile, const FrameIndex& index)
+{
+   const string tmpfile = idxfile + ".tmp";
+   std::FILE* file = std::fopen(tmpfile.c_str(), "wb");
+   if (!file) {
+      return false;
+   }
+   const std::int64_t head[4] = {INDEXVERSION, index.end, index.endline, index.num()};
+   vector<std::int64_t> entries(3 * index.num());
+   for (long k = 0; k != index.num(); ++k) {
+      entries[3 * k] = index.offset[k];
+      entries[3 * k + 1] = index.line[k];
+      entries[3 * k + 2] = index.npar[k];
+   }
+   bool ok = std::fwrite(INDEXMAGIC, sizeof(INDEXMAGIC), 1, file) == 1
+             && std::fwrite(head, sizeof(head), 1, file) == 1
+             && std::fwrite(entries.data(), sizeof(std::int64_t), entries.size(), file)
+                == entries.size();
+   ok = (std::fclose(file) == 0) && ok;
+   if (!ok || std::rename(tmpfile.c_str(), idxfile.c_str()) != 0) {
+      std::remove(tmpfile.c_str());
+      return false;
+   }
+   return true;
+}
+
+// Number of particles on the top line of a frame, [b, e), or -1 if
+// the line isn't a single non-negative integer.
+
+static long topline(const char* b, const char* e)
+{
+   if (numcolumns(b, e, 1) != 1) {
+      return -1;
+   }
+   while (b != e && isspace(*b)) {
+      ++b;
+   }
+   long npar = -1;
+   std::from_chars_result res = std::from_chars(b, e, npar);
+   return (res.ec == std::errc()) ? npar : -1;
+}
+
+// Add the complete frames of [begin, end) after index.end to index.  A
+// frame is found in the same way as by readxyzframe: blank lines
+// before the top line are skipped, and after the comment line, only
+// lines with the right number of columns (given by the comment line of
+// an extended XYZ frame) count as particles.
+
+static void extendindex(const char* begin, const char* end, FrameIndex& index)
+{
+   const char* p = begin + index.end;
+   long line = index.endline;
+   while (p != end) {
+      // top line, skipping any blank lines between frames
+      const long fline = line;
+      const char* e = p;
+      long nlines = 0;
+      while (p != end) {
+         e = static_cast<const char*>(memchr(p, '\n', end - p));
+         e = e ? e : end;
+         ++nlines;
+         if (numcolumns(p, e, 1) != 0) {
+            break;
+         }
+         p = (e == end) ? e : e + 1;
+      }
+      if (p == end) {
+         break;
+      }
+      const long npar = topline(p, e);
+      if (npar < 0) {
+         cout << "Warning: corrupt XYZ file, line " << fline + nlines
+              << " expected number of particles." << endl;
+         break;
+      }
+      const long top = p - begin;
+      const long topnum = fline + nlines;
+      p = (e == end) ? e : e + 1;
+
+      // comment line, then the particles
+      long nread = -1;
+      unsigned int ncols = 4; // number of columns in XYZ file
+      while (nread != npar && p != end) {
+         e = static_cast<const char*>(memchr(p, '\n', end - p));
+         e = e ? e : end;
+         ++nlines;
+         if (nread == -1) {
+            ncols = xyzcolumns(p, e);
+            ++nread;
+         }
+         else if (numcolumns(p, e, ncols) == ncols) {
+            ++nread;
+         }
+         p = (e == end) ? e : e + 1;
+      }
+      if (nread != npar) {
+         // the frame isn't complete (yet)
+         break;
+      }
+      index.offset.push_back(top);
+      index.line.push_back(topnum);
+      index.npar.push_back(npar);
+      if (p == end && end[-1] != '\n') {
+         // the last line may not be complete either, so this frame is
+         // indexed again next time (see frameindex)
+         break;
+      }
+      line = fline + nlines;
+      index.end = p - begin;
+      index.endline = line;
+   }
+}
+
+FrameIndex frameindex(const string& fname)
+{
+   FrameIndex index;
+   const int fd = open(fname.c_str(), O_RDONLY);
+   struct stat st;
+   if (fd == -1 || fstat(fd, &st) == -1) {
+      if (fd != -1) {
+         close(fd);
+      }
+      cout << "Warning: " << fname
+           << " does not exist or cannot be read." << endl;
+      return index;
+   }
+   const long size = st.st_size;
+   void* map = size ? mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+   close(fd);
+   if (map == MAP_FAILED) {
+      return index;
+   }
+   const char* begin = static_cast<const char*>(map);
+   const char* end = begin + size;
+
+   // the sidecar file is only used if the file hasn't got shorter, and
+   // the last indexed frame is still where it was (otherwise the file
+   // has been replaced, and is indexed again)
+   const string idxfile = fname + ".idx";
+   const bool found = readindex(idxfile, index);
+   const long nsaved = index.num();
+   const long endsaved = index.end;
+   if (found) {
+      // any frame after index.end is indexed again
+      const long nkeep = std::lower_bound(index.offset.begin(), index.offset.end(), index.end)
+                         - index.offset.begin();
+      index.offset.resize(nkeep);
+      index.line.resize(nkeep);
+      index.npar.resize(nkeep);
+   }
+   if (found && (index.end > size
+                 || (index.num() != 0
+                     && (index.offset.back() >= size
+                         || topline(begin + index.offset.back(),
+                                    std::find(begin + index.offset.back(), end, '\n'))
+                            != index.npar.back())))) {
+      index = FrameIndex();
+   }
+
+   extendindex(begin, end, index);
+   munmap(map, size);
+
+   if ((!found || index.num() != nsaved || index.end != endsaved)
+       && !writeindex(idxfile, index)) {
+      cout << "Warning: cannot write frame index " << idxfile << endl;
+   }
+   return index;
+}
@@ -0,0 +1,39 @@
+#ifndef FRAMEINDEX_H
+#define FRAMEINDEX_H
+
+#include <vector>
+#include <string>
+
+// FrameIndex stores where each frame of an XYZ trajectory starts, so
+// that a frame can be read (see readxyzframe) without reading all of
+// the frames before it.  The index is kept in a sidecar file (the name
+// of the XYZ file with .idx appended), and only complete frames are
+// indexed, so if the trajectory is still being written, the frames
+// added since are indexed the next time it is used.
+
+struct FrameIndex
+{
+   FrameIndex() : end(0), endline(0) { }
+
+   long num() const { return offset.size(); }
+
+   // byte offset of the top line of each frame, the line number of
+   // that line (from 1) and the number of particles
+   std::vector<long> offset;
+   std::vector<long> line;
+   std::vector<long> npar;
+   // the index covers bytes [0, end) of the file, which is endline
+   // lines
+   long end;
+   long endline;
+};
+
+// Index of the XYZ trajectory fname.  The index in the sidecar file is
+// used if there is one, and extended if the trajectory has grown (or
+// built again if it has been replaced), and the sidecar file is then
+// updated.  This is a single pass over the part of the file that
+// isn't indexed yet.
+
+FrameIndex frameindex(const std::string&);
+
+#endif
@@ -1,9 +1,12 @@
 #include <iostream>
 #include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
 #include "particlesystem.h"
 #include "particle.h"
 #include "box.h"
-#include "conncomponents.h"
+#include "neighbourlist.h"
 #include "utility.h"
 #include "diagonalize.h"
 #include "gtensor.h"
@@ -16,7 +19,7 @@ GTensor::GTensor(const ParticleSystem& psystem, const vector<int>& cnums)
 {
    // The gyration tensor itself
    gtensor.resize(boost::extents[3][3]);
-   gtensor = getgytensor(psystem, cnums);
+   gtensor = getgytensor(psystem, cnums, percolates);
 
    // Diagonalise complete tensor
    double fullg[] = {gtensor[0][0], gtensor[0][1], gtensor[0][2],
@@ -36,72 +39,74 @@ GTensor::GTensor(const ParticleSystem& psystem, const vector<int>& cnums)
    diagonalize(g, 2, res, topeig);
 }    
 
-// Take positions of particles in largest cluster.  Return particles
-// in the largest cluster, but without periodic BCS.  The trick here
-// is to replicate the system in x and y directions, then to find the
-// largest cluster in this large system (note the system is assumed
-// not to be periodic in z).
-
-vector<Particle> posnoperiodic(const vector<Particle>& cpars, const Box& simbox)
+// Remove the periodic boundary conditions from a cluster (see
+// gtensor.h).  This is a breadth first search over the bonds of the
+// cluster (from the neighbour list), starting from the first particle,
+// which stays where it is.  The separation vector of each bond gives
+// the image of the neighbour (as a whole number of box lengths in each
+// direction) from the image of the particle.  If a bond joins two
+// particles that have already been placed, but the images don't
+// agree, the cluster is connected to its own periodic image, i.e. it
+// percolates in that direction, and percolates[d] is set for direction
+// d.  The particles are found in cnums by bisection, so there is no
+// storage for each particle in the system, and clusters can be
+// unwrapped on several threads at once (see clusterstats).
+
+void unwrapcluster(const ParticleSystem& psystem, const vector<int>& cnums,
+                   vector<int>& image, bool* percolates)
 {
-   const vector<Particle>::size_type ncl = cpars.size();
-   const vector<Particle> repcpars = replicate(cpars, simbox);
-
-   // hack to ignore periodic bcs
-   Box bigbox = simbox;
-   bigbox.setdims(simbox.lboxx * 20, simbox.lboxy * 20, simbox.lboxz);
-
-   graph xgraph = getxgraph(repcpars, range(0, repcpars.size()), bigbox);
-   vector<int> cluspars = largestcomponent(xgraph);
-
-   // create vector of cluster positions
-   vector<Particle> ret;
-   ret.resize(ncl);
-   
-   for (vector<Particle>::size_type i = 0; i != ncl; ++i) {
-      ret[i] = repcpars[cluspars[i]];
-   }
-
-   return ret;
-}
-
-// Replicate particles in x and y directions.
-
-vector<Particle> replicate(const vector<Particle>& pars, const Box& simbox)
-{
-   const vector<Particle>::size_type npar = pars.size();
-   vector<Particle> newpars;
-   newpars.resize(9 * npar);
-
-   for (vector<Particle>::size_type i = 0; i != npar; ++i) {
-      // set the position in the replica as the original position 
-      for (int j = 0; j != 9; ++j) {
-         newpars[i + j*npar] = pars[i];
+   const NeighbourList& nlist = psystem.nlist;
+   const int ncl = cnums.size();
+   percolates[0] = percolates[1] = percolates[2] = false;
+
+   // image of each particle in cluster, and whether it has been placed
+   image.assign(3 * ncl, 0);
+   vector<char> placed(ncl, 0);
+   vector<int> queue;
+   queue.reserve(ncl);
+
+   // (each start is a new search, in case the particles aren't all
+   // connected)
+   for (int start = 0; start != ncl; ++start) {
+      if (placed[start]) {
+         continue;
+      }
+      placed[start] = 1;
+      queue.push_back(start);
+      for (vector<int>::size_type q = queue.size() - 1; q != queue.size(); ++q) {
+         const int i = queue[q];
+         const int pi = cnums[i];
+         const double* ri = psystem.allpars[pi].pos;
+         for (int k = nlist.offset[pi]; k != nlist.offset[pi + 1]; ++k) {
+            // position of the neighbour in cnums, if it is in the
+            // cluster
+            vector<int>::const_iterator it = std::lower_bound(cnums.begin(), cnums.end(),
+                                                              nlist.neigh[k]);
+            if (it == cnums.end() || *it != nlist.neigh[k]) {
+               continue;
+            }
+            const int j = it - cnums.begin();
+            const double* rj = psystem.allpars[nlist.neigh[k]].pos;
+            for (int d = 0; d != 3; ++d) {
+               // neighbour is at r_i - sep, which is offset from the
+               // original neighbour position by a whole number of
+               // box lengths
+               int offset = static_cast<int>(floor((ri[d] - nlist.sep[3 * k + d] - rj[d])
+                                                   / psystem.simbox.length(d) + 0.5));
+               if (!placed[j]) {
+                  image[3 * j + d] = image[3 * i + d] + offset;
+               }
+               else if (image[3 * j + d] != image[3 * i + d] + offset) {
+                  percolates[d] = true;
+               }
+            }
+            if (!placed[j]) {
+               placed[j] = 1;
+               queue.push_back(j);
+            }
+         }
       }
-      // now add the required offset
-      // top
-      newpars[i + npar].pos[1] += simbox.lboxy;
-      // top right
-      newpars[i + 2 * npar].pos[0] += simbox.lboxx;
-      newpars[i + 2 * npar].pos[1] += simbox.lboxy;          
-      // right
-      newpars[i + 3 * npar].pos[0] += simbox.lboxx;
-      // bottom right
-      newpars[i + 4 * npar].pos[0] += simbox.lboxx;
-      newpars[i + 4 * npar].pos[1] -= simbox.lboxy;                   
-      // bottom
-      newpars[i + 5 * npar].pos[1] -= simbox.lboxy;                   
-      // bottom left
-      newpars[i + 6 * npar].pos[0] -= simbox.lboxx;
-      newpars[i + 6 * npar].pos[1] -= simbox.lboxy;                   
-      // left
-      newpars[i + 7 * npar].pos[0] -= simbox.lboxx;
-      // top left
-      newpars[i + 8 * npar].pos[0] -= simbox.lboxx;
-      newpars[i + 8 * npar].pos[1] += simbox.lboxy;
    }
-
-   return newpars;
 }
 
 // Center of mass of particles.
@@ -163,25 +168,32 @@ tensor gytensor(const vector<Particle>& particles)
 
 // Return radius of gyration tensor.  Note that periodic boundary
 // conditions need to be removed before computing this. Here this is
-// achieved via the function replicate (defined above). note cnums
-// gives indices into psystem.allpars of particles in largest cluster.
+// achieved via the function unwrapcluster (defined above), which also
+// sets percolates. note cnums gives indices into psystem.allpars of
+// particles in largest cluster (in ascending order).
 
-tensor getgytensor(const ParticleSystem& psystem, const vector<int>& cnums)
+tensor getgytensor(const ParticleSystem& psystem, const vector<int>& cnums,
+                   bool* percolates)
 {
-   // build up vector of particles which are largest cluster only
+   // take away periodic bcs
+   vector<int> image;
+   unwrapcluster(psystem, cnums, image, percolates);
+
+   // build up vector of particles which are largest cluster only,
+   // each moved to its image
    vector<Particle>::size_type ncl = cnums.size();
    vector<Particle> clusterpars(ncl);
    
    for (vector<Particle>::size_type i = 0; i != ncl; ++i) {
-      clusterpars[i].pos[0] = psystem.allpars[cnums[i]].pos[0];
-      clusterpars[i].pos[1] = psystem.allpars[cnums[i]].pos[1];
-      clusterpars[i].pos[2] = psystem.allpars[cnums[i]].pos[2];
+      for (int d = 0; d != 3; ++d) {
+         clusterpars[i].pos[d] = psystem.allpars[cnums[i]].pos[d];
+         if (image[3 * i + d] != 0) {
+            clusterpars[i].pos[d] += image[3 * i + d] * psystem.simbox.length(d);
+         }
+      }
       // setting the symbol is not really necessary, do it anyway
       clusterpars[i].symbol = 'S';
    }
 
-   // take away periodic bcs
-   vector<Particle> cparsnop = posnoperiodic(clusterpars, psystem.simbox);
-
-   return gytensor(cparsnop);
+   return gytensor(clusterpars);
 }
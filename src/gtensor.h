@@ -16,12 +16,29 @@ public:
    // 2) The eigenvalues of the complete gyration tensor
    // 3) The eigenvalues of the top 2x2 portion of the gyration
    //    tensor.
+   // 4) Whether the cluster percolates (is connected to its own
+   //    periodic image) in the x, y and z directions, in which case
+   //    the gyration tensor is not very meaningful.
 	  
    tensor gtensor;
    double fulleig[3];
    double topeig[2];
+   bool percolates[3];
 };
 
-tensor getgytensor(const ParticleSystem&, const std::vector<int>&);
+tensor getgytensor(const ParticleSystem&, const std::vector<int>&, bool*);
+
+// Remove the periodic boundary conditions from a cluster, whose
+// particles cnums (indices into psystem.allpars) must be in ascending
+// order, e.g. from Clusters::members.  image[3 * i + d] is set to the
+// number of box lengths in direction d to add to the position of
+// particle cnums[i], so that each particle is next to its neighbours
+// in the cluster, and percolates[d] is set if the cluster is connected
+// to its own periodic image in direction d.  This is used for the
+// gyration tensor of the largest cluster, and of every cluster in
+// clusterstats.
+
+void unwrapcluster(const ParticleSystem&, const std::vector<int>&, std::vector<int>&,
+                   bool*);
 
 #endif
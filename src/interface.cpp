@@ -0,0 +1,69 @@
+#include <vector>
+#include "neighbourlist.h"
+#include "particlesystem.h"
+#include "clusters.h"
+#include "qdata.h"
+#include "qlmfunctions.h"
+#include "threadpool.h"
+#include "interface.h"
+
+using std::vector;
+
+vector<Interface> findinterfaces(const NeighbourList& nlist, const vector<unsigned char>& incluster,
+                                 const vector<unsigned char>& outside, const int nclass,
+                                 const QData& q6data, const QData& q4data)
+{
+   const int npar = nlist.size();
+
+   // bit c of atsurface[i] is set if particle i is in the interface of
+   // cluster c; we can stop looking at the neighbours of i as soon as
+   // it is known to be in all of the interfaces it can be in
+   vector<unsigned char> atsurface(npar, 0);
+   threadpool().parallelfor(npar, PARCHUNK, [&](int begin, int end) {
+      for (int i = begin; i != end; ++i) {
+         if (outside[i] == 0) {
+            continue;
+         }
+         unsigned char found = 0;
+         for (int k = nlist.offset[i]; k != nlist.offset[i + 1]; ++k) {
+            found |= outside[i] & incluster[nlist.neigh[k]];
+            if (found == outside[i]) {
+               break;
+            }
+         }
+         atsurface[i] = found;
+      }
+   });
+
+   vector<Interface> interfaces(nclass);
+   for (int c = 0; c != nclass; ++c) {
+      Interface& iface = interfaces[c];
+      iface.nlinks = 0;
+      for (int i = 0; i != npar; ++i) {
+         if (atsurface[i] & (1u << c)) {
+            iface.pnums.push_back(i);
+            iface.nlinks += q6data.numlinks[i];
+         }
+      }
+      iface.q6 = Qpars(q6data.qlm, iface.pnums, q6data.lval);
+      iface.q4 = Qpars(q4data.qlm, iface.pnums, q4data.lval);
+   }
+
+   return interfaces;
+}
+
+vector<Interface> xtalinterfaces(const ParticleSystem& psystem, const vector<LDCLASS>& ldclass,
+                                 const vector<TFCLASS>& tfclass, const vector<Clusters>& xclusters,
+                                 const int ldc, const int tfc,
+                                 const QData& q6data, const QData& q4data)
+{
+   const int npar = ldclass.size();
+   vector<unsigned char> incluster(npar);
+   vector<unsigned char> outside(npar);
+   for (int i = 0; i != npar; ++i) {
+      incluster[i] = (ldc >= 0 && xclusters[0].label[i] == ldc ? 1 : 0)
+                     | (tfc >= 0 && xclusters[1].label[i] == tfc ? 2 : 0);
+      outside[i] = (ldclass[i] == LIQUID ? 1 : 0) | (tfclass[i] == LIQ ? 2 : 0);
+   }
+   return findinterfaces(psystem.nlist, incluster, outside, 2, q6data, q4data);
+}
@@ -0,0 +1,53 @@
+#ifndef INTERFACE_H
+#define INTERFACE_H
+
+#include <vector>
+#include "neighbourlist.h"
+#include "particlesystem.h"
+#include "clusters.h"
+#include "qdata.h"
+
+// Interface stores the particles at the surface of a cluster, i.e.
+// the particles of some other class (usually the liquid-like
+// particles) that have at least one neighbour in the cluster, along
+// with the order parameters that are computed for them.
+
+struct Interface
+{
+   // N_s, the number of interface particles
+   int num() const { return pnums.size(); }
+
+   // indices of the interface particles, in ascending order
+   std::vector<int> pnums;
+
+   // N_l, the total number of crystalline links (from q6data) of the
+   // interface particles
+   int nlinks;
+
+   // average Q6 and Q4 of the interface particles
+   double q6;
+   double q4;
+};
+
+// Find the interfaces of nclass clusters at once: particle i is in
+// cluster c if bit c of incluster[i] is set, and it can be part of the
+// interface of cluster c if bit c of outside[i] is set.  Every
+// interface is found in a single sweep over the neighbour list, where
+// cluster membership is a bit test rather than a search of the
+// cluster's particle list.
+
+std::vector<Interface> findinterfaces(const NeighbourList&, const std::vector<unsigned char>&,
+                                      const std::vector<unsigned char>&, int,
+                                      const QData&, const QData&);
+
+// Interfaces of cluster ldc of the LD clusters (element 0 of the
+// result) and cluster tfc of the TF clusters (element 1), as returned
+// by xtalclusters.  The interface particles are the liquid particles
+// by the same classification.
+
+std::vector<Interface> xtalinterfaces(const ParticleSystem&, const std::vector<LDCLASS>&,
+                                      const std::vector<TFCLASS>&,
+                                      const std::vector<Clusters>&, int, int,
+                                      const QData&, const QData&);
+
+#endif
@@ -1,9 +1,13 @@
 #include <iostream>
 #include <string>
+#include <cstdlib>
+#include <thread>
 #include <vector>
 #include "particlesystem.h"
 #include "qdata.h"
+#include "threadpool.h"
 #include "constants.h"
+#include "snapshot.h"
 
 using std::vector;
 using std::cout;
@@ -13,18 +17,41 @@ using std::string;
 // Tool for outputting classification of each particle using the LD
 // method.  This reads in a file with the required parameters, and
 // outputs an XYZ co-ordinate file, which can be viewed with molecular
-// visualisation software, e.g. JMOL.  See README and the example for
-// further information and an example parameter file.
+// visualisation software, e.g. JMOL (or, with -o, a snapshot file with
+// the same symbols).  See README and the example for further
+// information and an example parameter file.
 
 int main(int argc, char* argv[])
 {
-   if (argc != 2) {
-      cout << "Syntax: " << argv[0] << " paramfile" << endl;
+   // optional number of threads to use (-t nthreads), if this is 0
+   // use one thread per core, and optional snapshot file to write
+   // instead of the XYZ output (-o snapshotfile)
+   int nthreads = 1;
+   string snapfile;
+   int argn = 1;
+   while (argn < argc - 2) {
+      if (string(argv[argn]) == "-t") {
+         nthreads = atoi(argv[argn + 1]);
+         if (nthreads == 0) {
+            nthreads = std::thread::hardware_concurrency();
+         }
+      }
+      else if (string(argv[argn]) == "-o") {
+         snapfile = argv[argn + 1];
+      }
+      else {
+         break;
+      }
+      argn += 2;
+   }
+   if (argc != argn + 1 || nthreads < 1) {
+      cout << "Syntax: " << argv[0] << " [-t nthreads] [-o snapshotfile] paramfile" << endl;
       return 1;
    }
+   setnumthreads(nthreads);
 
    // get name of input and output files
-   string pfile = argv[1];
+   string pfile = argv[argn];
 	  
    // create the particle system from name of input file
    // input file must contain the following fields:
@@ -43,8 +70,10 @@ int main(int argc, char* argv[])
    // warning: at the moment the number of links, and the threshold
    // value for a link is the same for both l=4 and l=6
    // (psystem.linval and psystem.nlinks respectively)
-   QData q6data(psystem, 6);
-   QData q4data(psystem, 4);
+   // (both at once, see multiqdata)
+   vector<QData> qdata = multiqdata(psystem, {6, 4});
+   const QData& q6data = qdata[0];
+   const QData& q4data = qdata[1];
 	  
    // from q6data and q4 data, classify each particle as bcc, hcp
    // etc.  using Lechner Dellago approach.
@@ -60,6 +89,18 @@ int main(int argc, char* argv[])
    jstr.push_back("B"); // ICOS (pink in jmol)
    jstr.push_back("O"); // SURFACE (red in jmol)
 
+   // the same output as a snapshot file (see snapshot.h), with the
+   // positions at full precision
+   if (!snapfile.empty()) {
+      vector<Particle> pars(psystem.allpars);
+      for (vector<Particle>::size_type i = 0; i != pars.size(); ++i) {
+         pars[i].symbol = jstr[ldclass[i]][0];
+      }
+      writesnapshot(pars, snapfile, psystem.simbox.length(0), psystem.simbox.length(1),
+                    psystem.simbox.length(2), psystem.simbox.zperiodic(), psystem.nsurf);
+      return 0;
+   }
+
    // output number of particles
    cout << ldclass.size() << endl << endl;
    for (int i = 0; i != psystem.allpars.size(); ++i) {
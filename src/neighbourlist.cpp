@@ -0,0 +1,79 @@
+#include <vector>
+#include <algorithm>
+#include "particle.h"
+#include "box.h"
+#include "celllist.h"
+#include "neighbourlist.h"
+#include "threadpool.h"
+
+using std::vector;
+
+// Constructor for neighbour list.
+
+NeighbourList::NeighbourList(const vector<Particle>& particles, const Box& simbox)
+{
+   build(particles, simbox);
+}
+
+// Find the neighbours using a cell list (see celllist.h).  Each block
+// of PARCHUNK particles is searched by a single thread into its own
+// buffers, which are then copied into place once the row offsets are
+// known.
+
+void NeighbourList::build(const vector<Particle>& particles, const Box& simbox)
+{
+   const int npar = particles.size();
+   const int nchunk = (npar + PARCHUNK - 1) / PARCHUNK;
+   cells.reset(particles, simbox);
+   vector<vector<int> >& cneigh = chunkneigh;
+   vector<vector<double> >& csep = chunksep;
+   cneigh.resize(nchunk);
+   csep.resize(nchunk);
+   chunknbrs.resize(nchunk);
+
+   offset.assign(npar + 1, 0);
+   threadpool().parallelfor(npar, PARCHUNK, [&](int begin, int end) {
+      const int c = begin / PARCHUNK;
+      cneigh[c].clear();
+      csep[c].clear();
+      vector<int>& nbrs = chunknbrs[c];
+      double s[3];
+      for (int i = begin; i != end; ++i) {
+         cells.neighbours(i, nbrs);
+         for (vector<int>::size_type j = 0; j != nbrs.size(); ++j) {
+            simbox.sep(particles[i], particles[nbrs[j]], s);
+            cneigh[c].push_back(nbrs[j]);
+            csep[c].push_back(s[0]);
+            csep[c].push_back(s[1]);
+            csep[c].push_back(s[2]);
+         }
+         offset[i + 1] = nbrs.size();
+      }
+   });
+
+   for (int i = 0; i != npar; ++i) {
+      offset[i + 1] += offset[i];
+   }
+   neigh.resize(offset[npar]);
+   sep.resize(3 * offset[npar]);
+   threadpool().parallelfor(nchunk, 1, [&](int begin, int end) {
+      for (int c = begin; c != end; ++c) {
+         const int k = offset[c * PARCHUNK];
+         std::copy(cneigh[c].begin(), cneigh[c].end(), neigh.begin() + k);
+         std::copy(csep[c].begin(), csep[c].end(), sep.begin() + 3 * k);
+      }
+   });
+
+   // the rows are sorted, so the reverse bonds can be found by bisection
+   reverse.resize(neigh.size());
+   threadpool().parallelfor(npar, PARCHUNK, [&](int begin, int end) {
+      for (int i = begin; i != end; ++i) {
+         for (int k = offset[i]; k != offset[i + 1]; ++k) {
+            const int j = neigh[k];
+            reverse[k] = std::lower_bound(neigh.begin() + offset[j],
+                                          neigh.begin() + offset[j + 1], i)
+                         - neigh.begin();
+         }
+      }
+   });
+}
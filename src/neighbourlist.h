@@ -0,0 +1,51 @@
+#ifndef NEIGHBOURLIST_H
+#define NEIGHBOURLIST_H
+
+#include <vector>
+#include "particle.h"
+#include "box.h"
+#include "celllist.h"
+
+// NeighbourList stores the neighbours of every particle in the system
+// in compressed sparse row (CSR) form.  The neighbours of particle i
+// are neigh[k] for offset[i] <= k < offset[i + 1], in ascending
+// order, and sep[3 * k], sep[3 * k + 1], sep[3 * k + 2] is the
+// separation r_i - r_j (modulo periodic bcs) for bond k.  The list is
+// computed once per configuration (see ParticleSystem) and is then
+// shared by everything that needs neighbours.  Every bond appears
+// twice, once in the row of each particle, and reverse[k] is the
+// index of bond k in the row of the neighbour, so that quantities
+// computed once per bond can be stored for both particles.
+
+struct NeighbourList
+{
+   NeighbourList() { }
+   NeighbourList(const std::vector<Particle>& particles, const Box& simbox);
+
+   // (re)compute the list for the given particles; the storage
+   // (including the cell list and the buffers below) is reused, so the
+   // list can be rebuilt for each frame of a trajectory without
+   // allocating, unless it needs more room than for earlier frames
+   void build(const std::vector<Particle>& particles, const Box& simbox);
+
+   // number of particles
+   int size() const { return offset.empty() ? 0 : offset.size() - 1; }
+
+   // number of neighbours of particle i
+   int numneigh(int i) const { return offset[i + 1] - offset[i]; }
+
+   std::vector<int> offset;
+   std::vector<int> neigh;
+   std::vector<double> sep;
+   std::vector<int> reverse;
+
+private:
+   // the cell list, and buffers for each block of particles, used by
+   // build
+   CellList cells;
+   std::vector<std::vector<int> > chunkneigh;
+   std::vector<std::vector<double> > chunksep;
+   std::vector<std::vector<int> > chunknbrs;
+};
+
+#endif
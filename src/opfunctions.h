@@ -2,8 +2,177 @@
 #define OPFUNCTIONS_H
 
 #include <complex>
+#include "constants.h"
 
-std::complex<double> ylm(int, int, double, double);
-double plm(int, int, double);
+// Square root that can be evaluated at compile time (Newton's
+// method), used for the normalisation constants below.
+
+constexpr double constsqrt(const double x)
+{
+   if (x <= 0.0) {
+      return 0.0;
+   }
+   double guess = x > 1.0 ? x : 1.0;
+   double prev = 0.0;
+   while (guess != prev) {
+      prev = guess;
+      guess = 0.5 * (guess + x / guess);
+      if (guess >= prev) {
+         break;
+      }
+   }
+   return guess;
+}
+
+// Normalisation coefficient of Y(l,m), m >= 0, for the recurrence
+// below: (-1)^m (2m - 1)!! sqrt((2l + 1) / 4pi (l - m)! / (l + m)!).
+
+constexpr double ylmcoeff(const int l, const int m)
+{
+   double dfact = 1.0; // (2m - 1)!!
+   for (int j = 1; j <= m; ++j) {
+      dfact *= 2 * j - 1;
+   }
+   // (l - m)! / (l + m)!
+   double fratio = 1.0;
+   for (int i = l - m + 1; i <= l + m; ++i) {
+      fratio /= i;
+   }
+   const double c = constsqrt((2.0 * l + 1.0) * fratio / (4.0 * PI)) * dfact;
+   return (m % 2 == 1) ? -c : c;
+}
+
+// Coefficients for computing all of the spherical harmonics Y(l,m) of
+// a vector in one pass (see ylms below).  We write
+// Y(l,m) = coeff[m] * R(l,m)(z) * (x + iy)^m
+// for m >= 0 and unit vector (x, y, z), where R(l,m) is the
+// associated Legendre polynomial P(l,m) with the factor
+// (-1)^m (2m - 1)!! (1 - z^2)^(m/2) taken out (the latter is absorbed
+// by (x + iy)^m, and the former by coeff).  R obeys the same
+// recurrence in l as P:
+// R(k,m) = reca[m][k] * z * R(k-1,m) - recb[m][k] * R(k-2,m).
+// The tables are computed at compile time for each l.
+
+template <int L>
+struct YlmCoeffs
+{
+   constexpr YlmCoeffs() : coeff(), reca(), recb()
+   {
+      for (int m = 0; m <= L; ++m) {
+         coeff[m] = ylmcoeff(L, m);
+         for (int k = m + 2; k <= L; ++k) {
+            reca[m][k] = (2.0 * k - 1.0) / (k - m);
+            recb[m][k] = (k + m - 1.0) / (k - m);
+         }
+      }
+   }
+
+   double coeff[L + 1];
+   double reca[L + 1][L + 1];
+   double recb[L + 1][L + 1];
+};
+
+// Spherical harmonics Y(l,m) for m = 0,..,l for the direction of
+// vector r (usually a bond between neighbours).  The real and
+// imaginary parts are stored in re[m] and im[m].  There are no
+// factorials and no trig functions here.  Note Y(l,-m) = (-1)^m
+// conj(Y(l,m)), so the values for m < 0 are not needed.
+
+template <int L>
+inline void ylms(const double* r, double* re, double* im)
+{
+   static constexpr YlmCoeffs<L> c = YlmCoeffs<L>();
+
+   const double rinv = 1.0 / std::sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
+   const double z = r[2] * rinv;
+   const std::complex<double> xy(r[0] * rinv, r[1] * rinv);
+
+   // (x + iy)^m
+   std::complex<double> xym(1.0, 0.0);
+
+   for (int m = 0; m <= L; ++m) {
+      // R(l,m)(z) from R(m,m) = 1 and R(m+1,m) = (2m + 1) z
+      double rmm = 1.0;
+      double rlm = rmm;
+      if (L > m) {
+         double rm1m = (2 * m + 1) * z;
+         for (int k = m + 2; k <= L; ++k) {
+            double rkm = c.reca[m][k] * z * rm1m - c.recb[m][k] * rmm;
+            rmm = rm1m;
+            rm1m = rkm;
+         }
+         rlm = rm1m;
+      }
+
+      std::complex<double> y = (c.coeff[m] * rlm) * xym;
+      re[m] = y.real();
+      im[m] = y.imag();
+      xym *= xy;
+   }
+}
+
+// Coefficients for computing Y(l,m) for every l = 0,..,LMAX at once
+// (see ylmsall below), coeff[l][m] is ylmcoeff(l, m).  The recurrence
+// coefficients don't depend on l, so are the same as in YlmCoeffs.
+
+template <int LMAX>
+struct YlmAllCoeffs
+{
+   constexpr YlmAllCoeffs() : coeff(), rec()
+   {
+      for (int l = 0; l <= LMAX; ++l) {
+         for (int m = 0; m <= l; ++m) {
+            coeff[l][m] = ylmcoeff(l, m);
+         }
+      }
+   }
+
+   double coeff[LMAX + 1][LMAX + 1];
+   YlmCoeffs<LMAX> rec;
+};
+
+// Spherical harmonics Y(l,m) for l = 0,..,LMAX and m = 0,..,l for the
+// direction of vector r.  The real and imaginary parts of Y(l,m) are
+// stored in re[l * (LMAX + 1) + m] and im[l * (LMAX + 1) + m].  The
+// Legendre recurrence in l is done only once for each m, and R(l,m)
+// is used for every l on the way.  The values are the same (bit for
+// bit) as ylms<l> for each l.
+
+template <int LMAX>
+inline void ylmsall(const double* r, double* re, double* im)
+{
+   static constexpr YlmAllCoeffs<LMAX> c = YlmAllCoeffs<LMAX>();
+   constexpr int NL = LMAX + 1;
+
+   const double rinv = 1.0 / std::sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
+   const double z = r[2] * rinv;
+   const std::complex<double> xy(r[0] * rinv, r[1] * rinv);
+
+   // (x + iy)^m
+   std::complex<double> xym(1.0, 0.0);
+
+   for (int m = 0; m <= LMAX; ++m) {
+      // R(m,m) = 1 and R(m+1,m) = (2m + 1) z
+      double rmm = 1.0;
+      std::complex<double> y = (c.coeff[m][m] * rmm) * xym;
+      re[m * NL + m] = y.real();
+      im[m * NL + m] = y.imag();
+      if (LMAX > m) {
+         double rm1m = (2 * m + 1) * z;
+         y = (c.coeff[m + 1][m] * rm1m) * xym;
+         re[(m + 1) * NL + m] = y.real();
+         im[(m + 1) * NL + m] = y.imag();
+         for (int k = m + 2; k <= LMAX; ++k) {
+            double rkm = c.rec.reca[m][k] * z * rm1m - c.rec.recb[m][k] * rmm;
+            rmm = rm1m;
+            rm1m = rkm;
+            y = (c.coeff[k][m] * rkm) * xym;
+            re[k * NL + m] = y.real();
+            im[k * NL + m] = y.imag();
+         }
+      }
+      xym *= xy;
+   }
+}
 
 #endif
@@ -34,31 +34,4 @@ double parfrac(const std::vector<etype>& pclass, const std::vector<int>& cnums,
    return static_cast<double>(num) / cnums.size();
 }
 
-// template for finding list of particles of a particular type
-// which have at least one neighbour in the list.  Used for N_s, which
-// is the number of liquid particles with at least 1 neighbour in
-// the cluster.  (It could conversely be used for finding indices of
-// particles in the cluster that have at least one liquid neighbour.
-
-template <class etype>
-std::vector<int> nparatleastone(const std::vector<etype>& pclass, const std::vector<int>& cnums,
-                                const etype plabel, const std::vector<std::vector<int> >& lneigh)
-{
-   std::vector<int> indexes;
-   for (typename std::vector<etype>::size_type i = 0; i != pclass.size(); ++i) {
-      if (pclass[i] == plabel) { // e.g. we are a liquid particle
-         // go through all neighbours
-         for (vector<int>::size_type j = 0; j != lneigh[i].size(); ++j) {
-            // is the neighbour in the list (usually cluster)?
-            if (find(cnums.begin(), cnums.end(), lneigh[i][j]) != cnums.end()) {
-               indexes.push_back(i);
-               break;
-            }
-         }
-      }
-   }
-
-   return indexes;
-}
-
 #endif
@@ -2,9 +2,14 @@
 #include <string>
 #include <cstdlib>
 #include <iostream>
+#include <sstream>
+#include <memory>
 #include "particlesystem.h"
 #include "readwrite.h"
+#include "snapshot.h"
+#include "decompress.h"
 #include "box.h"
+#include "neighbourlist.h"
 #include "compile.h"
 
 using std::map;
@@ -12,15 +17,81 @@ using std::string;
 using std::cout;
 using std::endl;
 
+// Set parameter name to value, unless it is already in params (the
+// value is written so that it is read back exactly).
+
+template <class T>
+static void setdefault(map<string, string>& params, const string& name, const T& value)
+{
+   if (!params.count(name)) {
+      std::ostringstream ss;
+      ss.precision(17);
+      ss << value;
+      params[name] = ss.str();
+   }
+}
+
 // Constructor for ParticleSystem object.
 
-ParticleSystem::ParticleSystem(string pfile)
+ParticleSystem::ParticleSystem(string pfile, bool readpositions)
+{
+   load(pfile, readpositions);
+}
+
+// Read the parameters and the particle positions (see constructor).
+
+void ParticleSystem::load(string pfile, bool readpositions, std::ostream& warn)
 {
    // read parameters from specified file
    map<string, string> params = readparams(pfile);
 
-   // particle positions from xyz file
-   allpars = readxyz(params["filename"].c_str());
+   // particle positions from xyz file, or from the first frame of a
+   // snapshot file (see snapshot.h), which also stores the box and the
+   // number of surface particles, or of a LAMMPS dump; these are used
+   // unless they are given in the parameter file, as is the box of the
+   // first frame of an extended XYZ file or a LAMMPS dump
+   xyzfile = params["filename"];
+   fixedbox = params.count("lboxx") || params.count("lboxy") || params.count("lboxz");
+   Snapshot snap;
+   const bool lammps = islammpsdump(xyzfile);
+   if (issnapshot(xyzfile) && snap.open(xyzfile, warn)) {
+      setdefault(params, "lboxx", snap.lbox(0));
+      setdefault(params, "lboxy", snap.lbox(1));
+      setdefault(params, "lboxz", snap.lbox(2));
+      setdefault(params, "zperiodic", snap.zperiodic() ? "True" : "False");
+      setdefault(params, "nparsurf", snap.numsurface());
+   }
+   else {
+      FrameBox box = readframebox(xyzfile);
+      if (box.found) {
+         setdefault(params, "lboxx", box.lbox[0]);
+         setdefault(params, "lboxy", box.lbox[1]);
+         setdefault(params, "lboxz", box.lbox[2]);
+      }
+      else if (box.nonorthogonal && !fixedbox) {
+         warn << "Warning: the box of " << xyzfile << " is not orthorhombic,"
+              << " so the box must be given in the parameter file." << endl;
+      }
+      if (box.pbcfound) {
+         setdefault(params, "zperiodic", box.zperiodic ? "True" : "False");
+      }
+   }
+   if (!readpositions || (snap.isopen() && snap.numframes() == 0)) {
+      allpars.clear();
+   }
+   else if (snap.isopen()) {
+      snap.frame(0, allpars, warn);
+   }
+   else if (lammps) {
+      std::unique_ptr<std::istream> infile = openinput(xyzfile, warn);
+      int lread = 0;
+      if (!infile || !readlammpsframe(*infile, allpars, lread, 0, warn)) {
+         allpars.clear();
+      }
+   }
+   else {
+      allpars = readxyz(xyzfile.c_str(), true, true, 0, warn);
+   }
 
    // get box parameters and use to create box
    double lboxx = atof(params["lboxx"].c_str());
@@ -40,6 +111,10 @@ ParticleSystem::ParticleSystem(string pfile)
    linval = atof(params["q6link"].c_str());
    nlinks = atoi(params["q6numlinks"].c_str());
 
+   // neighbour list, this is computed only once for the system (or
+   // once per frame, see update)
+   nlist.build(allpars, simbox);
+
    if (LOGGING) {
       cout << LOGMSG << "read " << allpars.size() << " particles" << endl
            << LOGMSG << "values for particle system: " << endl
@@ -50,6 +125,14 @@ ParticleSystem::ParticleSystem(string pfile)
            << LOGMSG << "zperiodic " << zperiodic << endl
            << LOGMSG << "nparsurf " << nsurf << endl
            << LOGMSG << "q6link " << linval << endl
-           << LOGMSG << "q6numlinks " << nlinks << endl;
+           << LOGMSG << "q6numlinks " << nlinks << endl
+           << LOGMSG << "total neighbours " << nlist.neigh.size() << endl;
    }
 }
+
+// Rebuild the neighbour list for the current particle positions.
+
+void ParticleSystem::update()
+{
+   nlist.build(allpars, simbox);
+}
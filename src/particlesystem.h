@@ -3,8 +3,10 @@
 
 #include<vector>
 #include<string>
+#include<iostream>
 #include "box.h"
 #include "particle.h"
+#include "neighbourlist.h"
 
 using std::vector;
 using std::string;
@@ -16,13 +18,34 @@ using std::string;
 struct ParticleSystem
 {
    // constructor: this will set the correct values for all of the
-   // variables defined below.
-   ParticleSystem(string pfile);
+   // variables defined below.  If readpositions is false, the
+   // particles are not read from xyzfile (e.g. if it is a trajectory
+   // that will be read one frame at a time, see readxyzframe), and
+   // allpars and nlist are empty until update is called.
+   ParticleSystem() { }
+   ParticleSystem(string pfile, bool readpositions = true);
 
+   // set all of the variables below from the parameter file pfile (as
+   // for the constructor), reusing the storage of the neighbour list,
+   // e.g. for the next configuration in a batch; the warnings from
+   // reading the particles are written to warn
+   void load(string pfile, bool readpositions = true, std::ostream& warn = std::cout);
+
+   // recompute everything that depends on the particle positions
+   // (i.e. the neighbour list) after allpars has been changed, e.g. to
+   // the next frame of a trajectory
+   void update();
+
+   // name of the xyz file with the particle positions
+   string xyzfile;
    // particle positions
    vector<Particle> allpars;
    // simulation box
    Box simbox;
+   // true if the box is given in the parameter file, otherwise it can
+   // come from the file itself, and for a trajectory whose frames each
+   // give their box (e.g. a LAMMPS dump) it is set for every frame
+   bool fixedbox;
    // number of surface particles
    unsigned int nsurf;
    // threshold value of Sij for particles i and j to form a crystal link
@@ -31,6 +54,9 @@ struct ParticleSystem
    unsigned int nlinks;
    // neighbour separation, if rij < nsep particles are neighbours
    double nsep;
+   // neighbours of every particle (computed once, and then used for
+   // the qlm data, the clusters and the gyration tensor)
+   NeighbourList nlist;
 };
 
 #endif
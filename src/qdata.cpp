@@ -1,22 +1,30 @@
 #include <iostream>
+#include <cstdlib>
+#include <utility>
 #include <vector>
+#include <algorithm>
 #include <complex>
-#include "boost/multi_array.hpp"
 #include "qdata.h"
 #include "box.h"
 #include "particle.h"
 #include "qlmfunctions.h"
 #include "constants.h"
-#include "conncomponents.h"
+#include "clusters.h"
 #include "utility.h"
 #include "typedefs.h"
+#include "qlmarray.h"
+#include "neighbourlist.h"
+#include "threadpool.h"
 
 using std::vector;
 using std::complex;
 using std::norm;
+using std::cout;
+using std::endl;
 
 // QData stores qlm in its various forms for each particle in the
-// system. Usually l=6 or 4 but the code will accept any value.
+// system. Usually l=6 or 4 but the code will accept any value up to
+// MAXL (see constants.h).
 //
 // The first thing to do is to compute the 2l + 1 dimensional vector
 // qlm(i) (m = -l,..,0,..,l) for each particle i in the system.
@@ -75,38 +83,136 @@ using std::norm;
 //      in a crystalline environment is the familiar Frenkel/ ten Wolde
 //      order parameter (which I call N_cl in my papers).
 
-// Constructor for QData object.
+// Compute all of the qlm data for l = L.  The qlm functions are
+// templates on l (see qlmfunctions.h).  If qlmin is not null, it is
+// the (already computed) matrix of qlm values, which is moved from.
 
-QData::QData(const ParticleSystem& psystem, const int _lval) : lval(_lval)
+template <int L>
+void qdatal(QData& qdata, const ParticleSystem& psystem, QlmArray* qlmin)
 {
-   // store number of neighbours and neighbour list
-   vector<Particle>::size_type npar = psystem.allpars.size();
-   numneigh.resize(npar, 0); // num neighbours for each particle
-   lneigh.resize(npar); // neighbour particle nums for each particle
+   // neighbours of each particle
+   const NeighbourList& nlist = psystem.nlist;
 
    // matrix of qlm values
-   qlm.resize(boost::extents[npar][2 * lval + 1]);
-   qlm = qlms(psystem.allpars, psystem.simbox, numneigh, lneigh, lval);
-
-   // Lechner dellago eq 6
-   array2d qlmb = qlmbars(qlm, lneigh, lval);
+   qdata.qlm = qlmin ? std::move(*qlmin) : qlms<L>(nlist);
 
-   // get qls and wls
-   ql = qls(qlm);
-   wl = wls(qlm);
-   
-   // lechner dellago eq 5
-   qlbar = qls(qlmb);
-   wlbar = wls(qlmb);
+   // get qls and wls, and from qlmbar (Lechner dellago eq 6) the
+   // averaged versions (lechner dellago eq 5 and 7)
+   qwls<L>(qdata.qlm, nlist, qdata.ql, qdata.wl, qdata.qlbar, qdata.wlbar);
 
    // compute number of crystalline 'links'
    // first get normalised vectors qlm (-l <= m <= l) for computing
    // dot product Sij
-   array2d qlmt = qlmtildes(qlm, numneigh, lval);
+   qlmtildes<L>(qdata.qlm, nlist, qdata.qlmt);
+
+   // do dot products Sij (once per bond) to get number of links
+   bondsij<L>(qdata.qlmt, nlist, qdata.sij);
+   getnlinks(qdata.sij, nlist, psystem.nsurf, psystem.linval, qdata.numlinks);
+}
+
+// Call qdatal<L> with L equal to the run time value qdata.lval, by
+// trying L = MAXL, MAXL - 1, ..., 0 in turn.
+
+template <int L>
+void dispatchl(QData& qdata, const ParticleSystem& psystem, QlmArray* qlmin)
+{
+   if (qdata.lval == L) {
+      qdatal<L>(qdata, psystem, qlmin);
+   }
+   else {
+      dispatchl<L - 1>(qdata, psystem, qlmin);
+   }
+}
+
+template <>
+void dispatchl<-1>(QData& qdata, const ParticleSystem&, QlmArray*)
+{
+   cout << "Error: QData is only available for 0 <= l <= " << MAXL
+        << " (l = " << qdata.lval << ")" << endl;
+   exit(1);
+}
+
+// Constructor for QData object.
+
+QData::QData(const ParticleSystem& psystem, const int _lval) : lval(_lval)
+{
+   dispatchl<MAXL>(*this, psystem, 0);
+}
+
+// Constructor for QData object from an already computed qlm matrix
+// (see multiqdata).
+
+QData::QData(const ParticleSystem& psystem, const int _lval, QlmArray&& qlmin)
+   : lval(_lval)
+{
+   dispatchl<MAXL>(*this, psystem, &qlmin);
+}
+
+// Call multiqlms<LMAX> with LMAX equal to the run time value lmax, in
+// the same way as dispatchl.
+
+template <int LMAX>
+void dispatchmulti(const NeighbourList& nlist, const vector<int>& lvals, const int lmax,
+                   vector<QlmArray>& qlm)
+{
+   if (lmax == LMAX) {
+      multiqlms<LMAX>(nlist, lvals, qlm);
+   }
+   else {
+      dispatchmulti<LMAX - 1>(nlist, lvals, lmax, qlm);
+   }
+}
+
+template <>
+void dispatchmulti<-1>(const NeighbourList&, const vector<int>&, const int lmax,
+                       vector<QlmArray>&)
+{
+   cout << "Error: QData is only available for 0 <= l <= " << MAXL
+        << " (l = " << lmax << ")" << endl;
+   exit(1);
+}
+
+// QData for each l in lvals, in the same order.  The result is the
+// same as constructing QData for each l separately, but the spherical
+// harmonics of each bond are computed for all l at once, so e.g. all
+// of q2,..,q12 cost much less than 6 separate QData objects.
+
+vector<QData> multiqdata(const ParticleSystem& psystem, const vector<int>& lvals)
+{
+   vector<QData> qdata;
+   multiqdata(psystem, lvals, qdata);
+   return qdata;
+}
+
+// The same as above, but the result is stored in qdata, and the
+// storage of the existing elements is reused (e.g. for each frame of a
+// trajectory, when qdata is the result for the previous frame).
+
+void multiqdata(const ParticleSystem& psystem, const vector<int>& lvals, vector<QData>& qdata)
+{
+   int lmax = 0;
+   for (vector<int>::size_type li = 0; li != lvals.size(); ++li) {
+      if (lvals[li] < 0 || lvals[li] > MAXL) {
+         cout << "Error: QData is only available for 0 <= l <= " << MAXL
+              << " (l = " << lvals[li] << ")" << endl;
+         exit(1);
+      }
+      lmax = std::max(lmax, lvals[li]);
+   }
+
+   // the qlm matrices are computed into the storage of the existing
+   // ones, and then moved back
+   qdata.resize(lvals.size());
+   vector<QlmArray> qlm(lvals.size());
+   for (vector<int>::size_type li = 0; li != lvals.size(); ++li) {
+      qlm[li] = std::move(qdata[li].qlm);
+   }
+   dispatchmulti<MAXL>(psystem.nlist, lvals, lmax, qlm);
 
-   // do dot products Sij to get number of links
-   numlinks = getnlinks(qlmt, numneigh, lneigh, psystem.nsurf,
-                        psystem.nlinks, psystem.linval, lval);
+   for (vector<int>::size_type li = 0; li != lvals.size(); ++li) {
+      qdata[li].lval = lvals[li];
+      dispatchl<MAXL>(qdata[li], psystem, &qlm[li]);
+   }
 }
 
 // Classify particles as either Liquid-like or crystalline according
@@ -117,16 +223,20 @@ vector<TFCLASS> classifyparticlestf(const ParticleSystem& psystem, const QData&
    int npar = q6data.ql.size();
    vector<TFCLASS> parclass(npar, LIQ);
 
-   // from nlinks, work out which particles are xtal
-   vector<int> xps = xtalpars(q6data.numlinks, psystem.nlinks);
-     
-   for (vector<LDCLASS>::size_type i = 0; i != psystem.nsurf; ++i) {
-      parclass[i] = SURF;
-   }
-
-   for (vector<int>::size_type i = 0; i != xps.size(); ++i) {
-      parclass[xps[i]] = XTAL;
-   }
+   // from nlinks, work out which particles are xtal (at least nlinks
+   // crystal links), the remaining surface particles are SURF
+   const int nlinks = psystem.nlinks;
+   const int nsurf = psystem.nsurf;
+   threadpool().parallelfor(npar, PARCHUNK, [&](int begin, int end) {
+      for (int i = begin; i != end; ++i) {
+         if (q6data.numlinks[i] >= nlinks) {
+            parclass[i] = XTAL;
+         }
+         else if (i < nsurf) {
+            parclass[i] = SURF;
+         }
+      }
+   });
 
    return parclass;
 }
@@ -140,85 +250,89 @@ vector<LDCLASS> classifyparticlesld(const ParticleSystem& psystem, const QData&
    unsigned int npar = q6data.ql.size();
    vector<LDCLASS> parclass(npar);
 
-   for (unsigned int i = 0; i != npar; ++i) {
-      if (i < psystem.nsurf) {
-         parclass[i] = SURFACE;
-      }
-      else {
-         if (q6data.qlbar[i] < 0.3) {
-            parclass[i] = LIQUID;
+   threadpool().parallelfor(npar, PARCHUNK, [&](int begin, int end) {
+      for (unsigned int i = begin; i != static_cast<unsigned int>(end); ++i) {
+         if (i < psystem.nsurf) {
+            parclass[i] = SURFACE;
          }
-         else { // particle is solid
-            if (abs(q6data.wlbar[i]) > 0.05) {
-               parclass[i] = ICOS;
-            }
-            else if (q6data.wlbar[i] > 0.0) {
-               parclass[i] = BCC;
+         else {
+            if (q6data.qlbar[i] < 0.3) {
+               parclass[i] = LIQUID;
             }
-            else { // either HCP or FCC
-               if (q4data.wlbar[i] > 0.0) {
-                  parclass[i] = HCP;
+            else { // particle is solid
+               if (abs(q6data.wlbar[i]) > 0.05) {
+                  parclass[i] = ICOS;
                }
-               else {
-                  parclass[i] = FCC;
+               else if (q6data.wlbar[i] > 0.0) {
+                  parclass[i] = BCC;
+               }
+               else { // either HCP or FCC
+                  if (q4data.wlbar[i] > 0.0) {
+                     parclass[i] = HCP;
+                  }
+                  else {
+                     parclass[i] = FCC;
+                  }
                }
             }
          }
       }
-   }
+   });
 
    return parclass;
 }
 
+// Is a particle with LD classification ldc crystalline?
+
+static inline bool isxtalld(const LDCLASS ldc)
+{
+   return (ldc == FCC) or (ldc == HCP) or (ldc == BCC) or (ldc == ICOS);
+}
+
+// Clusters of crystalline particles, using both the LD classifications
+// (element 0 of xclusters) and the TF classifications (element 1).
+// Both sets of clusters are found in the same sweep over the
+// neighbour list (see clusters.h).
+
+void xtalclusters(const ParticleSystem& psystem, const vector<LDCLASS>& ldclass,
+                  const vector<TFCLASS>& tfclass, vector<Clusters>& xclusters)
+{
+   const int npar = ldclass.size();
+   vector<unsigned char> mask(npar);
+   for (int i = 0; i != npar; ++i) {
+      mask[i] = (isxtalld(ldclass[i]) ? 1 : 0) | (tfclass[i] == XTAL ? 2 : 0);
+   }
+   findclusters(psystem.nlist, mask, 2, xclusters);
+}
+
 // Largest cluster using LD classifications.
 
 vector<int> largestclusterld(const ParticleSystem& psystem, const vector<LDCLASS>& ldclass)
 {
-   // get vector with indices that are all crystal particles
-   vector<int> xps;
+   // mark all of the crystal particles
+   vector<unsigned char> mask(ldclass.size());
    for (vector<LDCLASS>::size_type i = 0; i != ldclass.size(); ++i) {
-      if ((ldclass[i] == FCC) or (ldclass[i] == HCP) or
-          (ldclass[i] == BCC) or (ldclass[i] == ICOS)) {
-         xps.push_back(i);
-      }
+      mask[i] = isxtalld(ldclass[i]) ? 1 : 0;
    }
 
-   // graph of xtal particles, with each particle a vertex and each
-   // link an edge
-   graph xgraph = getxgraph(psystem.allpars, xps, psystem.simbox);
-
-   // largest cluster is the largest connected component of graph
-   vector<int> cnums = largestcomponent(xgraph);
-
-   // now largest component returns indexes into array xps, we need
-   // to reindex so that it contains indices into psystem.allpars
-   // (see utility.cpp)
-   reindex(cnums, xps);
-   return cnums;
+   // largest cluster is the largest connected set of crystal
+   // particles
+   Clusters clusters = findclusters(psystem.nlist, mask, 1)[0];
+   return clusters.members(clusters.largest());
 }
 
 // Largest cluster using TF classifications.
 
 vector<int> largestclustertf(const ParticleSystem& psystem, const vector<TFCLASS>& tfclass)
 {
-   // get vector with indices that are all crystal particles
-   vector<int> xps;
-   for (vector<LDCLASS>::size_type i = 0; i != tfclass.size(); ++i) {
-      if (tfclass[i] == XTAL) {
-         xps.push_back(i);
-      }
+   // mark all of the crystal particles
+   vector<unsigned char> mask(tfclass.size());
+   for (vector<TFCLASS>::size_type i = 0; i != tfclass.size(); ++i) {
+      mask[i] = (tfclass[i] == XTAL) ? 1 : 0;
    }
 
-   // graph of xtal particles, with each particle a vertex and each
-   // link an edge
-   graph xgraph = getxgraph(psystem.allpars, xps, psystem.simbox);
-
-   // largest cluster is the largest connected component of graph
-   vector<int> cnums = largestcomponent(xgraph);
-
-   // now largest component returns indexes into array xps, we need
-   // to reindex so that it contains indices into psystem.allpars
-   // (see utility.cpp)
-   reindex(cnums, xps);
-   return cnums;    
+   // largest cluster is the largest connected set of crystal
+   // particles
+   Clusters clusters = findclusters(psystem.nlist, mask, 1)[0];
+   return clusters.members(clusters.largest());
 }
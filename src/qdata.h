@@ -4,7 +4,9 @@
 #include <vector>
 #include "particlesystem.h"
 #include "typedefs.h"
+#include "qlmarray.h"
 #include "constants.h"
+#include "clusters.h"
 
 // QData is a struct to store data used for the Steindhardt bond order
 // parameters. The struct exists since we don't want to recompute
@@ -13,21 +15,18 @@
 struct QData
 {
 public:
+   QData() : lval(0) { }
    QData(const ParticleSystem& psystem, int lval);
+   QData(const ParticleSystem& psystem, int lval, QlmArray&& qlm);
 
    // store the l value, usually either 4 or 6
    int lval;
-     
-   // we store the number of neighbours for each particle as well as
-   // a vector of neighbour particles for each particle in this
-   // structure. This is a slightly annoying place to store this
-   // information.  It is here since the neighbours are computed when
-   // calculating the qlm matrix (see functions qlms).
-   vector<int> numneigh;
-   vector<vector<int> > lneigh;
-
-   // the complete qlm matrix
-   array2d qlm;
+
+   // note the neighbours of each particle are not stored here, they
+   // are in the neighbour list psystem.nlist
+
+   // the complete qlm matrix (use qlm(i, m + l) for qlm(i))
+   QlmArray qlm;
      
    // ql, \bar{ql}, wl, \bar{wl} for each particle i
    std::vector<double> ql;
@@ -35,13 +34,25 @@ public:
    std::vector<double> wl;
    std::vector<double> wlbar;
 
+   // the dot product Sij of the normalised qlm(i) and qlm(j) for
+   // every bond, indexed in the same way as psystem.nlist.neigh
+   std::vector<double> sij;
+
+   // the normalised qlm(i), used for sij (this is kept so that its
+   // storage can be reused for the next frame, see multiqdata)
+   QlmArray qlmt;
+
    // the number of crystalline 'links' that each particle has
    // warning: this only really makes sense for the case l = 6
    vector<int> numlinks;
 };
 
+std::vector<QData> multiqdata(const ParticleSystem&, const std::vector<int>&);
+void multiqdata(const ParticleSystem&, const std::vector<int>&, std::vector<QData>&);
 std::vector<TFCLASS> classifyparticlestf(const ParticleSystem&, const QData&);
 std::vector<LDCLASS> classifyparticlesld(const ParticleSystem&, const QData&, const QData&);
+void xtalclusters(const ParticleSystem&, const std::vector<LDCLASS>&,
+                  const std::vector<TFCLASS>&, std::vector<Clusters>&);
 std::vector<int> largestclusterld(const ParticleSystem&, const std::vector<LDCLASS>&);
 std::vector<int> largestclustertf(const ParticleSystem&, const std::vector<TFCLASS>&);
 
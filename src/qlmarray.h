@@ -0,0 +1,86 @@
+#ifndef QLMARRAY_H
+#define QLMARRAY_H
+
+#include <vector>
+#include <complex>
+#include "utility.h"
+
+// QlmArray stores the 2l + 1 dimensional vector qlm(i) (m = -l,..,l)
+// for every particle i.  Since q(l,-m) = (-1)^m conj(q(l,m)), only
+// m = 0,..,l are stored, and element k of a row is for m = k.  Sums
+// over all m of |qlm|^2 (or of qlm(i) conj(qlm(j))) are then the m = 0
+// term plus twice the m > 0 terms (see mweight).
+//
+// The storage is 'structure of arrays': the real parts and the
+// imaginary parts are in two separate planes, and each row is padded
+// with zeros to a multiple of 8 doubles, so that every row starts on a
+// 64 byte boundary and can be processed with whole SIMD registers (see
+// the qlm functions in qlmfunctions.h).
+
+class QlmArray
+{
+public:
+   QlmArray() : npar(0), lval(0), nstride(0) { }
+   QlmArray(int _npar, int _lval) : npar(_npar), lval(_lval),
+                                    nstride(rowstride(_lval)),
+                                    data(2 * _npar * rowstride(_lval), 0.0) { }
+
+   // change the size to npar particles and l = _lval, and set every
+   // element to zero.  The storage is kept if it is big enough, so an
+   // array can be reused for each frame of a trajectory.
+   void reset(int _npar, int _lval)
+   {
+      npar = _npar;
+      lval = _lval;
+      nstride = rowstride(_lval);
+      data.assign(2 * _npar * nstride, 0.0);
+   }
+
+   // length of each (padded) row for given l
+   static constexpr int rowstride(int l) { return (l + 1 + 7) / 8 * 8; }
+
+   int size() const { return npar; }
+   int l() const { return lval; }
+   int stride() const { return nstride; }
+
+   // real and imaginary parts of row i
+   double* re(int i) { return &data[i * nstride]; }
+   const double* re(int i) const { return &data[i * nstride]; }
+   double* im(int i) { return &data[(npar + i) * nstride]; }
+   const double* im(int i) const { return &data[(npar + i) * nstride]; }
+
+   // qlm(i) for any m = -l,..,l as a complex number
+   std::complex<double> operator()(int i, int m) const;
+
+private:
+   int npar;
+   int lval;
+   int nstride;
+   std::vector<double, AlignedAllocator<double> > data;
+};
+
+// Weight of the m'th element of a row in a sum over all m = -l,..,l.
+
+inline double mweight(const int m)
+{
+   return m == 0 ? 1.0 : 2.0;
+}
+
+// Element m = -l,..,l of a row stored for m = 0,..,l (re[m], im[m]),
+// using q(l,-m) = (-1)^m q(l,m)* for m < 0.
+
+inline std::complex<double> qlmrow(const double* re, const double* im, const int m)
+{
+   if (m >= 0) {
+      return std::complex<double>(re[m], im[m]);
+   }
+   return (m % 2 == 0) ? std::complex<double>(re[-m], -im[-m])
+                       : std::complex<double>(-re[-m], im[-m]);
+}
+
+inline std::complex<double> QlmArray::operator()(int i, int m) const
+{
+   return qlmrow(re(i), im(i), m);
+}
+
+#endif
@@ -3,23 +3,516 @@
 
 #include <vector>
 #include <complex>
+#include <cmath>
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
 #include "particle.h"
 #include "box.h"
-#include "typedefs.h"
-
-std::vector<int> xtalpars(const std::vector<int>&, const int);
-std::vector<int> getnlinks(const array2d&, const std::vector<int>&,
-                           const std::vector<std::vector<int> >&,
-                           const int, const int, const double,
-                           const int);
-
-array2d qlmtildes(const array2d&, const std::vector<int>&, const int);
-array2d qlmbars(const array2d&, const std::vector<std::vector<int> >&, const int);
-array2d qlms(const std::vector<Particle>&, const Box&, std::vector<int>&,
-             std::vector<std::vector<int> >&, const int);
-double Qpars(const array2d&, const std::vector<int>&, const int);
-
-std::vector<double> qls(const array2d&);
-std::vector<double> wls(const array2d&);
+#include "qlmarray.h"
+#include "constants.h"
+#include "opfunctions.h"
+#include "neighbourlist.h"
+#include "threadpool.h"
+#include "wigner.h"
+
+void getnlinks(const std::vector<double>&, const NeighbourList&, const int, const double,
+               std::vector<int>&);
+double Qpars(const QlmArray&, const std::vector<int>&, const int);
+
+// The functions below compute the qlm data for every particle.  They
+// are templates on l, so that the loops over m have a trip count that
+// is known at compile time (see QData, which chooses the template
+// from the value of l at run time).  The data is stored in a
+// QlmArray, which only has m = 0,..,l, and where each row is padded to
+// NS = QlmArray::rowstride(L) doubles; loops that can safely include
+// the (zero) padding run over all NS elements.  See qdata.cpp for the
+// definitions of the various quantities.
+
+// Return matrix of qlm(i) for every particle i.  Since
+// Y(l,m)(-r) = (-1)^l Y(l,m)(r), the spherical harmonics of each bond
+// are only computed once (from the particle with the smaller index)
+// and are added to the qlm of both particles.  The neighbour lists are
+// sorted, so the contributions to each qlm(i) are still added in order
+// of neighbour index, and the result is exactly the same as visiting
+// every bond from both ends.  With more than one thread, the bonds of
+// a particle can't be added to another particle's row without a data
+// race, so the spherical harmonics of each bond are first stored for
+// both ends (using nlist.reverse), and each thread then adds up the
+// rows of its own particles in neighbour order.  The sums are the same
+// as those of the serial loop, so the result is identical for any
+// number of threads.
+
+template <int L>
+QlmArray qlms(const NeighbourList& nlist)
+{
+   const int npar = nlist.size();
+   QlmArray qlm(npar, L);
+   const double parity = (L % 2 == 0) ? 1.0 : -1.0;
+
+   if (threadpool().size() > 1) {
+      // spherical harmonics for m >= 0 of every bond, L + 1 per bond
+      constexpr int NY = L + 1;
+      std::vector<double> ybre(nlist.neigh.size() * NY);
+      std::vector<double> ybim(nlist.neigh.size() * NY);
+      threadpool().parallelfor(npar, PARCHUNK, [&](int begin, int end) {
+         for (int i = begin; i != end; ++i) {
+            for (int j = nlist.offset[i]; j != nlist.offset[i + 1]; ++j) {
+               if (nlist.neigh[j] < i) {
+                  continue;
+               }
+               double* yre = &ybre[j * NY];
+               double* yim = &ybim[j * NY];
+               ylms<L>(&nlist.sep[3 * j], yre, yim);
+               double* rre = &ybre[nlist.reverse[j] * NY];
+               double* rim = &ybim[nlist.reverse[j] * NY];
+               for (int k = 0; k != L + 1; ++k) {
+                  rre[k] = parity * yre[k];
+                  rim[k] = parity * yim[k];
+               }
+            }
+         }
+      });
+      threadpool().parallelfor(npar, PARCHUNK, [&](int begin, int end) {
+         for (int i = begin; i != end; ++i) {
+            double* qre = qlm.re(i);
+            double* qim = qlm.im(i);
+            for (int j = nlist.offset[i]; j != nlist.offset[i + 1]; ++j) {
+               for (int k = 0; k != L + 1; ++k) {
+                  qre[k] += ybre[j * NY + k];
+                  qim[k] += ybim[j * NY + k];
+               }
+            }
+         }
+      });
+   }
+   else {
+      // spherical harmonics for m >= 0, for a single bond
+      double yre[L + 1];
+      double yim[L + 1];
+
+      for (int i = 0; i != npar; ++i) {
+         double* qre = qlm.re(i);
+         double* qim = qlm.im(i);
+         for (int j = nlist.offset[i]; j != nlist.offset[i + 1]; ++j) {
+            const int n = nlist.neigh[j];
+            if (n < i) {
+               continue;
+            }
+            // compute contribution of neighbour to qlm of particle i,
+            // using the separation vector of the bond, and the
+            // contribution of particle i to qlm of the neighbour
+            ylms<L>(&nlist.sep[3 * j], yre, yim);
+            double* nre = qlm.re(n);
+            double* nim = qlm.im(n);
+            for (int k = 0; k != L + 1; ++k) {
+               qre[k] += yre[k];
+               qim[k] += yim[k];
+               nre[k] += parity * yre[k];
+               nim[k] += parity * yim[k];
+            }
+         }
+      }
+   }
+
+   threadpool().parallelfor(npar, PARCHUNK, [&](int begin, int end) {
+      for (int i = begin; i != end; ++i) {
+         double* qre = qlm.re(i);
+         double* qim = qlm.im(i);
+
+         // We now have N_b(i) * qlm(i) for particle i stored in row i
+         // Now divide by N_b(i)
+         if (nlist.numneigh(i) >= 1) {
+            const double nb = nlist.numneigh(i);
+            for (int k = 0; k != L + 1; ++k) {
+               qre[k] = qre[k] / nb;
+               qim[k] = qim[k] / nb;
+            }
+         }
+      }
+   });
+
+   return qlm;
+}
+
+// Compute matrices of qlm(i) for every particle i, for each l in
+// lvals (which must all be <= LMAX), into qlm (whose storage is
+// reused).  This is the same as calling qlms for each l in turn, but
+// the spherical harmonics of each bond for all of the l values come
+// from a single pass of the Legendre recurrence (see ylmsall), rather
+// than from a separate pass for each l.
+
+template <int LMAX>
+void multiqlms(const NeighbourList& nlist, const std::vector<int>& lvals,
+               std::vector<QlmArray>& qlm)
+{
+   constexpr int NL = LMAX + 1;
+   const int npar = nlist.size();
+   const int nl = lvals.size();
+   qlm.resize(nl);
+   for (int li = 0; li != nl; ++li) {
+      qlm[li].reset(npar, lvals[li]);
+   }
+
+   if (threadpool().size() > 1) {
+      // as in qlms, store the spherical harmonics of every bond for
+      // both ends, and then add up the rows of each particle; the
+      // values for lvals[li] start at element loff[li] of a bond
+      std::vector<int> loff(nl + 1, 0);
+      for (int li = 0; li != nl; ++li) {
+         loff[li + 1] = loff[li] + lvals[li] + 1;
+      }
+      const int ny = loff[nl];
+      std::vector<double> ybre(nlist.neigh.size() * ny);
+      std::vector<double> ybim(nlist.neigh.size() * ny);
+      threadpool().parallelfor(npar, PARCHUNK, [&](int begin, int end) {
+         double yre[NL * NL];
+         double yim[NL * NL];
+         for (int i = begin; i != end; ++i) {
+            for (int j = nlist.offset[i]; j != nlist.offset[i + 1]; ++j) {
+               if (nlist.neigh[j] < i) {
+                  continue;
+               }
+               ylmsall<LMAX>(&nlist.sep[3 * j], yre, yim);
+               const int r = nlist.reverse[j];
+               for (int li = 0; li != nl; ++li) {
+                  const int l = lvals[li];
+                  const double parity = (l % 2 == 0) ? 1.0 : -1.0;
+                  for (int k = 0; k != l + 1; ++k) {
+                     ybre[j * ny + loff[li] + k] = yre[l * NL + k];
+                     ybim[j * ny + loff[li] + k] = yim[l * NL + k];
+                     ybre[r * ny + loff[li] + k] = parity * yre[l * NL + k];
+                     ybim[r * ny + loff[li] + k] = parity * yim[l * NL + k];
+                  }
+               }
+            }
+         }
+      });
+      threadpool().parallelfor(npar, PARCHUNK, [&](int begin, int end) {
+         for (int i = begin; i != end; ++i) {
+            for (int j = nlist.offset[i]; j != nlist.offset[i + 1]; ++j) {
+               for (int li = 0; li != nl; ++li) {
+                  double* qre = qlm[li].re(i);
+                  double* qim = qlm[li].im(i);
+                  for (int k = 0; k != lvals[li] + 1; ++k) {
+                     qre[k] += ybre[j * ny + loff[li] + k];
+                     qim[k] += ybim[j * ny + loff[li] + k];
+                  }
+               }
+            }
+         }
+      });
+   }
+   else {
+      // spherical harmonics for all l and m >= 0, for a single bond
+      double yre[NL * NL];
+      double yim[NL * NL];
+
+      for (int i = 0; i != npar; ++i) {
+         for (int j = nlist.offset[i]; j != nlist.offset[i + 1]; ++j) {
+            const int n = nlist.neigh[j];
+            if (n < i) {
+               continue;
+            }
+            // as in qlms, add the contribution of the bond to both
+            // particles, with Y(l,m)(-r) = (-1)^l Y(l,m)(r)
+            ylmsall<LMAX>(&nlist.sep[3 * j], yre, yim);
+            for (int li = 0; li != nl; ++li) {
+               const int l = lvals[li];
+               const double parity = (l % 2 == 0) ? 1.0 : -1.0;
+               double* qre = qlm[li].re(i);
+               double* qim = qlm[li].im(i);
+               double* nre = qlm[li].re(n);
+               double* nim = qlm[li].im(n);
+               for (int k = 0; k != l + 1; ++k) {
+                  qre[k] += yre[l * NL + k];
+                  qim[k] += yim[l * NL + k];
+                  nre[k] += parity * yre[l * NL + k];
+                  nim[k] += parity * yim[l * NL + k];
+               }
+            }
+         }
+      }
+   }
+
+   threadpool().parallelfor(npar, PARCHUNK, [&](int begin, int end) {
+      for (int i = begin; i != end; ++i) {
+         // divide N_b(i) * qlm(i) by N_b(i)
+         if (nlist.numneigh(i) >= 1) {
+            const double nb = nlist.numneigh(i);
+            for (int li = 0; li != nl; ++li) {
+               double* qre = qlm[li].re(i);
+               double* qim = qlm[li].im(i);
+               for (int k = 0; k != lvals[li] + 1; ++k) {
+                  qre[k] = qre[k] / nb;
+                  qim[k] = qim[k] / nb;
+               }
+            }
+         }
+      }
+   });
+}
+
+// Compute qlmbar(i), qlm for particle i averaged over itself and all
+// of its nearest neighbours. See Lechner and Dellago JCP 129, 114707
+// Equation (6) BUT (!) note there is an error in Lechner Dellago
+// equation: The denominator should be N_b + 1 rather than N_b.  This
+// is corrected in: Jungblut and Dellago JCP 134, 104501 (2011)
+// Equation (5).  The row is written to bre and bim (NS doubles
+// each).
+
+template <int L>
+inline void qlmbarrow(const QlmArray& qlm, const NeighbourList& nlist, int i,
+                      double* bre, double* bim)
+{
+   constexpr int NS = QlmArray::rowstride(L);
+   for (int m = 0; m != NS; ++m) {
+      bre[m] = qlm.re(i)[m];
+      bim[m] = qlm.im(i)[m];
+   }
+   // add contribution from neighbours, one row at a time
+   for (int k = nlist.offset[i]; k != nlist.offset[i + 1]; ++k) {
+      const double* jre = qlm.re(nlist.neigh[k]);
+      const double* jim = qlm.im(nlist.neigh[k]);
+      for (int m = 0; m != NS; ++m) {
+         bre[m] += jre[m];
+         bim[m] += jim[m];
+      }
+   }
+   const double nn = nlist.numneigh(i) + 1;
+   for (int m = 0; m != NS; ++m) {
+      bre[m] = bre[m] / nn;
+      bim[m] = bim[m] / nn;
+   }
+}
+
+// Convert matrix of qlm(i) to matrix of \tilde{qlm}(i) \tilde{qlm}(i)
+// is simply a normalised version of vector qlm(i).  The result is
+// stored in qlmt (whose storage is reused).
+
+template <int L>
+void qlmtildes(const QlmArray& qlm, const NeighbourList& nlist, QlmArray& qlmt)
+{
+   constexpr int NS = QlmArray::rowstride(L);
+   const int npar = qlm.size();
+   qlmt.reset(npar, L);
+
+   // normalise each of rows in the matrix, this gives qlmtilde
+   threadpool().parallelfor(npar, PARCHUNK, [&](int begin, int end) {
+      for (int i = begin; i != end; ++i) {
+         // if particle has no neighbours, all entries in qlm[i]
+         // will be zero, and so the norm will be zero
+         if (nlist.numneigh(i) >= 1) {
+            const double* qre = qlm.re(i);
+            const double* qim = qlm.im(i);
+            double qnorm = 0.0;
+            for (int k = 0; k != L + 1; ++k) {
+               qnorm = qnorm + mweight(k) * (qre[k] * qre[k] + qim[k] * qim[k]);
+            }
+            qnorm = std::sqrt(qnorm);
+            for (int k = 0; k != NS; ++k) {
+               qlmt.re(i)[k] = qre[k] / qnorm;
+               qlmt.im(i)[k] = qim[k] / qnorm;
+            }
+         }
+      }
+   });
+}
+
+// Dot product of two vectors of N doubles.  When the code is built for
+// a CPU with AVX-512 or AVX (e.g. make ARCH=native) and N is a multiple
+// of the vector width, which it is for the padded QlmArray rows, this
+// is an explicit SIMD kernel with one partial sum per lane.  Otherwise
+// it is written with four independent partial sums so that the
+// compiler can vectorise it (SSE2 by default), which it cannot do for a
+// single running sum without reordering the additions.
+
+template <int N>
+inline double dotn(const double* a, const double* b)
+{
+#if defined(__AVX512F__)
+   if constexpr (N % 8 == 0) {
+      __m512d acc = _mm512_setzero_pd();
+      for (int n = 0; n != N; n += 8) {
+         acc = _mm512_add_pd(acc, _mm512_mul_pd(_mm512_loadu_pd(a + n),
+                                                _mm512_loadu_pd(b + n)));
+      }
+      const __m256d acc4 = _mm256_add_pd(_mm512_castpd512_pd256(acc),
+                                         _mm512_extractf64x4_pd(acc, 1));
+      alignas(32) double lanes[4];
+      _mm256_store_pd(lanes, acc4);
+      return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+   }
+#elif defined(__AVX__)
+   if constexpr (N % 4 == 0) {
+      __m256d acc = _mm256_setzero_pd();
+      for (int n = 0; n != N; n += 4) {
+         acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_loadu_pd(a + n),
+                                                _mm256_loadu_pd(b + n)));
+      }
+      alignas(32) double lanes[4];
+      _mm256_store_pd(lanes, acc);
+      return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+   }
+#endif
+   double acc[4] = {0.0, 0.0, 0.0, 0.0};
+   int n = 0;
+   for (; n + 4 <= N; n += 4) {
+      for (int v = 0; v != 4; ++v) {
+         acc[v] += a[n + v] * b[n + v];
+      }
+   }
+   for (; n != N; ++n) {
+      acc[n % 4] += a[n] * b[n];
+   }
+   return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+}
+
+// Return the dot product S_ij = \tilde{qlm}(i).\tilde{qlm}(j) for
+// every bond in the neighbour list (indexed in the same way as
+// nlist.neigh).  S_ij = S_ji, so each bond is only computed once and
+// is stored for both particles.  S_ij is the sum over m of
+// Re(qlm(i)) Re(qlm(j)) + Im(qlm(i)) Im(qlm(j)), i.e. twice the sum
+// of the dot products of the (padded) real and imaginary rows, minus
+// the m = 0 term which must only be counted once.  Each bond is only
+// written by the thread that has the particle with the smaller index.
+// The result is stored in sij (whose storage is reused).
+
+template <int L>
+void bondsij(const QlmArray& qlmt, const NeighbourList& nlist, std::vector<double>& sij)
+{
+   constexpr int NS = QlmArray::rowstride(L);
+   const int npar = qlmt.size();
+   sij.resize(nlist.neigh.size());
+
+   threadpool().parallelfor(npar, PARCHUNK, [&](int begin, int end) {
+      for (int i = begin; i != end; ++i) {
+         const double* ire = qlmt.re(i);
+         const double* iim = qlmt.im(i);
+         const int kend = nlist.offset[i + 1];
+         for (int k = nlist.offset[i]; k != kend; ++k) {
+            const int j = nlist.neigh[k];
+            if (j < i) {
+               continue;
+            }
+#ifdef __GNUC__
+            // the neighbour rows are scattered through memory, so fetch
+            // the rows for the next bond while this one is computed
+            if (k + 1 != kend) {
+               __builtin_prefetch(qlmt.re(nlist.neigh[k + 1]));
+               __builtin_prefetch(qlmt.im(nlist.neigh[k + 1]));
+            }
+#endif
+            const double* jre = qlmt.re(j);
+            const double* jim = qlmt.im(j);
+            sij[k] = 2.0 * (dotn<NS>(ire, jre) + dotn<NS>(iim, jim))
+                     - (ire[0] * jre[0] + iim[0] * jim[0]);
+            sij[nlist.reverse[k]] = sij[k];
+         }
+      }
+   });
+}
+
+// The squared norm sum_m |qlm(i)|^2 of a single particle, from the
+// real and imaginary parts of qlm(i).
+
+template <int L>
+inline double qnormrow(const double* re, const double* im)
+{
+   double qvalue = 0.0;
+   for (int m = 0; m != L + 1; ++m) {
+      // |qlm|^2, counted twice for m > 0 (once for -m)
+      qvalue += mweight(m) * (re[m] * re[m] + im[m] * im[m]);
+   }
+   return qvalue;
+}
+
+// The sum of Wigner 3j symbols times triple products of qlm(i), which
+// is the numerator of wl, see Lechner Dellago JCP 129 114707 (2008)
+// equation (4).  For l = 4 and l = 6 the Wigner symbols are the hard
+// coded ones in constants.h, for other l they are generated (see
+// wigner.h).  Both tables list each triple (m1, m2, m3) only once
+// together with (-m1, -m2, -m3): the two products are complex
+// conjugates (l is even, and m1 + m2 + m3 = 0), so the pair adds up to
+// twice the real part of one of them, which is folded into the
+// weights.  The sum is real, so only the real parts are accumulated.
+
+template <int L>
+inline double wlsum(const double* re, const double* im)
+{
+   // the real part of w * q(m1) q(m2) q(m3), where negative m are
+   // taken from the stored m >= 0 by conjugation
+   auto term = [re, im](double w, int m1, int m2, int m3) {
+      return w * std::real(qlmrow(re, im, m1) * qlmrow(re, im, m2)
+                           * qlmrow(re, im, m3));
+   };
+
+   // cycle through the wigner symbols in the order they appear in
+   // constants.h, remembering to multiply by the correct number of
+   // identical permutations
+   double wval = 0.0;
+   if constexpr (L == 6) {
+      for (int pnum = 0; pnum != 16; ++pnum) {
+         wval += term(WIGNERPERM6[pnum] * WIGNER6[pnum], WIGNERINDX6[pnum][0],
+                      WIGNERINDX6[pnum][1], WIGNERINDX6[pnum][2]);
+      }
+   }
+   else if constexpr (L == 4) {
+      for (int pnum = 0; pnum != 9; ++pnum) {
+         wval += term(WIGNERPERM4[pnum] * WIGNER4[pnum], WIGNERINDX4[pnum][0],
+                      WIGNERINDX4[pnum][1], WIGNERINDX4[pnum][2]);
+      }
+   }
+   else {
+      const WignerTable& wt = wignertable(L);
+      for (std::vector<double>::size_type t = 0; t != wt.w.size(); ++t) {
+         wval += term(wt.w[t], wt.m1[t], wt.m2[t], wt.m3[t]);
+      }
+   }
+
+   return wval;
+}
+
+// ql and wl of a single particle from the real and imaginary parts of
+// qlm(i), see Lechner Dellago JCP 129 114707 (2008) equations (3) and
+// (4), computing the norm of qlm(i) only once.  Passing the row of
+// \bar{qlm}(i) instead gives \bar{ql(i)} and \bar{wl(i)} (LD
+// equations (5) and (7)).
+
+template <int L>
+inline void qwlrow(const double* re, const double* im, double& ql, double& wl)
+{
+   const double qvalue = qnormrow<L>(re, im);
+   ql = std::sqrt(qvalue * (4.0 * PI / (2 * L + 1)));
+   wl = wlsum<L>(re, im) / std::pow(qvalue, 1.5);
+}
+
+// Get ql(i), wl(i), \bar{ql(i)} and \bar{wl(i)} (LD equations (3),
+// (4), (5) and (7)) for all particles in a single pass.
+// \bar{qlm(i)} is built for one particle at a time on the stack (see
+// qlmbarrow), rather than storing the whole qlmbar matrix.
+
+template <int L>
+void qwls(const QlmArray& qlm, const NeighbourList& nlist,
+          std::vector<double>& ql, std::vector<double>& wl,
+          std::vector<double>& qlbar, std::vector<double>& wlbar)
+{
+   constexpr int NS = QlmArray::rowstride(L);
+   const int npar = qlm.size();
+   ql.resize(npar);
+   wl.resize(npar);
+   qlbar.resize(npar);
+   wlbar.resize(npar);
+
+   threadpool().parallelfor(npar, PARCHUNK, [&](int begin, int end) {
+      alignas(64) double bre[NS];
+      alignas(64) double bim[NS];
+      for (int i = begin; i != end; ++i) {
+         qwlrow<L>(qlm.re(i), qlm.im(i), ql[i], wl[i]);
+         qlmbarrow<L>(qlm, nlist, i, bre, bim);
+         qwlrow<L>(bre, bim, qlbar[i], wlbar[i]);
+      }
+   });
+}
 
 #endif
@@ -1,17 +1,28 @@
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <sstream>
+#include <memory>
 #include <algorithm>
 #include <map>
 #include <vector>
+#include <charconv>
+#include <cstring>
+#include <cmath>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "particle.h"
+#include "threadpool.h"
+#include "decompress.h"
+#include "readwrite.h"
 
 using std::vector;
 using std::ifstream;
 using std::ofstream;
 using std::setprecision;
 using std::string;
-using std::cout;
 using std::endl;
 using std::map;
      
@@ -52,7 +63,7 @@ vector<string> split(const string& str)
 
 // Write vector of particles to output file in the normal XYZ format.
 
-void writexyz(vector<Particle> pars, const string fname, bool writesymbols = true)
+void writexyz(vector<Particle> pars, const string fname, bool writesymbols)
 {
    ofstream outfile(fname.c_str());
    int npar = pars.size();
@@ -97,93 +108,838 @@ map<string, string> readparams(const string fname)
    return params;
 }
 
-// Read vector of particles from file in the normal XYZ format.
+// Whitespace in an XYZ file (the same characters as isspace in the C
+// locale, but without a function call per character).
 
-vector<Particle> readxyz(const string fname, bool symbols = true,
-                         bool gettypes = true)
+static inline bool xyzspace(char c)
 {
-   vector<Particle> allpars;
-   int npar = 0;
-   ifstream infile(fname.c_str());
-   // map to define conversion between character symbol
-   // and particle type (an integer)
-   map<char,int> partypes;
-   partypes['O'] = 1;
-   partypes['S'] = 0;
-   partypes['N'] = 0;
+   return c == ' ' || (c >= '\t' && c <= '\r');
+}
 
-   // check that file exists and can be read from
-   if (!infile) {
-      cout << "Warning: " << fname
-           << " does not exist or cannot be read." << endl;
-      // return empty vector of particles
-      return allpars;
+static inline bool notxyzspace(char c)
+{
+   return !xyzspace(c);
+}
+
+// Number of whitespace separated columns in the line [b, e), counting
+// no further than maxcols + 1.
+
+unsigned int numcolumns(const char* b, const char* e, unsigned int maxcols)
+{
+   unsigned int ncols = 0;
+   while (ncols <= maxcols) {
+      b = std::find_if(b, e, notxyzspace);
+      if (b == e) {
+         break;
+      }
+      ++ncols;
+      b = std::find_if(b, e, xyzspace);
+   }
+   return ncols;
+}
+
+// Convert the token [b, e) to a double.  This is std::from_chars
+// (which gives the same value as atof, but doesn't need a null
+// terminated string or the locale), except that a leading + is allowed
+// as for atof.  Returns false if the whole token isn't a number.
+
+static bool todouble(const char* b, const char* e, double& x)
+{
+   if (b != e && *b == '+') {
+      ++b;
+   }
+   std::from_chars_result res = std::from_chars(b, e, x);
+   return res.ec == std::errc() && res.ptr == e;
+}
+
+// Convert the whitespace separated numbers in [b, e) to at most n
+// doubles.  Returns the number converted, or -1 if one of them isn't a
+// number.
+
+static int todoubles(const char* b, const char* e, double* x, int n)
+{
+   int nread = 0;
+   for (b = std::find_if(b, e, notxyzspace); b != e && nread != n; ++nread) {
+      const char* te = std::find_if(b, e, xyzspace);
+      if (!todouble(b, te, x[nread])) {
+         return -1;
+      }
+      b = std::find_if(te, e, notxyzspace);
+   }
+   return nread;
+}
+
+// Layout of the particle lines of an XYZ frame: the number of columns,
+// the column of the symbol (-1 if there isn't one) and of x (y and z
+// follow it), and the origin of the box, which is subtracted from the
+// positions.  Normally this is the symbol and then x, y and z (or just
+// x, y and z), but an extended XYZ frame can give a different layout
+// (see parsecomment).
+
+struct XYZLayout
+{
+   explicit XYZLayout(bool symbols)
+      : ncols(3 + symbols), symbol(symbols ? 0 : -1), pos(symbols), shift(false)
+   {
+      origin[0] = origin[1] = origin[2] = 0.0;
+   }
+
+   unsigned int ncols;
+   int symbol;
+   int pos;
+   bool shift;
+   double origin[3];
+};
+
+// Read the key=value pairs of the comment line [b, e) of an extended
+// XYZ frame (values with spaces are in double quotes, and the keys
+// aren't case sensitive).  Lattice (the three box vectors) and pbc set
+// box, and Properties (name:type:columns for each property, where the
+// symbol is species:S:1 and the positions are pos:R:3) and Origin set
+// layout.  Anything else, including the comment line of a plain XYZ
+// frame, is ignored.
+
+static void parsecomment(const char* b, const char* e, XYZLayout& layout, FrameBox& box)
+{
+   while ((b = std::find_if(b, e, notxyzspace)) != e) {
+      const char* ke = b;
+      while (ke != e && *ke != '=' && !xyzspace(*ke)) {
+         ++ke;
+      }
+      string key(b, ke);
+      std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+      const char* vb = ke;
+      const char* ve = ke;
+      b = ke;
+      if (ke != e && *ke == '=') {
+         vb = ke + 1;
+         if (vb != e && *vb == '"') {
+            ++vb;
+            ve = std::find(vb, e, '"');
+            b = (ve == e) ? e : ve + 1;
+         }
+         else {
+            ve = b = std::find_if(vb, e, xyzspace);
+         }
+      }
+
+      if (key == "lattice") {
+         double lattice[9];
+         if (todoubles(vb, ve, lattice, 9) == 9) {
+            box.nonorthogonal = (lattice[1] != 0.0 || lattice[2] != 0.0 || lattice[3] != 0.0
+                                 || lattice[5] != 0.0 || lattice[6] != 0.0 || lattice[7] != 0.0);
+            box.found = !box.nonorthogonal;
+            for (int d = 0; d != 3; ++d) {
+               box.lbox[d] = lattice[4 * d];
+            }
+         }
+      }
+      else if (key == "pbc") {
+         vector<string> flags = split(string(vb, ve));
+         if (flags.size() == 3) {
+            box.pbcfound = true;
+            box.zperiodic = (flags[2][0] == 'T' || flags[2][0] == 't' || flags[2] == "1");
+         }
+      }
+      else if (key == "origin") {
+         layout.shift = (todoubles(vb, ve, layout.origin, 3) == 3);
+      }
+      else if (key == "properties") {
+         // fields name:type:columns
+         vector<string> fields(1);
+         for (const char* c = vb; c != ve; ++c) {
+            if (*c == ':') {
+               fields.push_back("");
+            }
+            else {
+               fields.back() += *c;
+            }
+         }
+         XYZLayout props(false);
+         props.ncols = 0;
+         props.pos = -1;
+         for (vector<string>::size_type f = 0; f + 2 < fields.size(); f += 3) {
+            const int n = atoi(fields[f + 2].c_str());
+            if (fields[f] == "species" && fields[f + 1] == "S" && n == 1) {
+               props.symbol = props.ncols;
+            }
+            else if (fields[f] == "pos" && fields[f + 1] == "R" && n == 3) {
+               props.pos = props.ncols;
+            }
+            props.ncols += std::max(n, 0);
+         }
+         // without the positions the usual layout is the best guess
+         if (props.pos != -1) {
+            layout.ncols = props.ncols;
+            layout.symbol = props.symbol;
+            layout.pos = props.pos;
+         }
+      }
    }
+}
+
+// Number of columns of the particle lines of an XYZ frame whose comment
+// line is [b, e), e.g. for the frame index, which must count the
+// particles in the same way as readxyzframe.
+
+unsigned int xyzcolumns(const char* b, const char* e, bool symbols)
+{
+   XYZLayout layout(symbols);
+   FrameBox box;
+   parsecomment(b, e, layout, box);
+   return layout.ncols;
+}
+
+// Read a particle from the line [b, e) of an XYZ file, which must have
+// the right number of columns for layout (see numcolumns).  Returns
+// false if one of the positions isn't a number.
 
+static bool parseparticle(const char* b, const char* e, const XYZLayout& layout, bool gettypes,
+                          Particle& par)
+{
+   const int last = std::max(layout.symbol, layout.pos + 2);
+   for (int c = 0; c <= last; ++c) {
+      b = std::find_if(b, e, notxyzspace);
+      const char* te = std::find_if(b, e, xyzspace);
+      if (c == layout.symbol) { // note the symbol must only be a single character
+         par.symbol = *b;
+         // conversion between character symbol and particle type (an
+         // integer): O is type 1, anything else (S, N) is type 0
+         if (gettypes)
+            par.type = (par.symbol == 'O');
+      }
+      else if (c >= layout.pos && c < layout.pos + 3) {
+         if (!todouble(b, te, par.pos[c - layout.pos])) {
+            return false;
+         }
+      }
+      b = te;
+   }
+   if (layout.shift) {
+      for (int d = 0; d != 3; ++d) {
+         par.pos[d] -= layout.origin[d];
+      }
+   }
+   return true;
+}
+
+// End of the line starting at b, i.e. the next newline or e.
+
+static const char* lineend(const char* b, const char* e)
+{
+   const char* n = static_cast<const char*>(memchr(b, '\n', e - b));
+   return n ? n : e;
+}
+
+// Approximate number of bytes of an XYZ file parsed by each task.
+
+static const long XYZCHUNK = 1 << 20;
+
+// Parse the XYZ file fname, whose contents are [begin, end), into
+// allpars, and the comment line into box (see readxyz).  The file is
+// split into chunks of whole lines, which are parsed on the thread
+// pool.  The first pass over each chunk counts its lines and
+// particles, so that the second can convert the positions straight
+// into their place in the result.  The warnings are collected and
+// written to warn in line order afterwards, so the output doesn't
+// depend on the number of threads.
+
+static void parsexyz(const char* const begin, const char* const end, const string& fname,
+                     bool symbols, bool gettypes, vector<Particle>& allpars,
+                     FrameBox& box, std::ostream& warn)
+{
    // read number of particles (must be top line of XYZ file)
-   try {
-      infile >> npar;
-   } catch (...) {
-      cout << "Warning: " << fname
+   int npar = 0;
+   const char* p = std::find_if(begin, end, notxyzspace);
+   std::from_chars_result res = std::from_chars(p, end, npar);
+   if (res.ec != std::errc() || npar < 0) {
+      warn << "Warning: " << fname
            << " does not appear to be an XYZ file."
            << " Top line must be integer number of particles." << endl
            << " No particles found." << endl;
+      return;
+   }
+
+   // the particles start after the comment line, which may give the
+   // box and the layout of the lines for an extended XYZ file
+   const int lfirst = 3 + std::count(begin, res.ptr, '\n');
+   XYZLayout layout(symbols);
+   p = lineend(res.ptr, end);
+   if (p != end) {
+      const char* comment = p + 1;
+      p = lineend(comment, end);
+      parsecomment(comment, p, layout, box);
+   }
+   if (p != end) {
+      ++p;
+   }
+
+   // chunks of whole lines, chunk c is [cbegin[c], cbegin[c + 1])
+   const int nchunk = std::max(1L, (end - p) / XYZCHUNK);
+   vector<const char*> cbegin(nchunk + 1, end);
+   cbegin[0] = p;
+   for (int c = 1; c != nchunk; ++c) {
+      const char* b = std::max(cbegin[c - 1], p + (end - p) / nchunk * c);
+      b = lineend(b, end);
+      cbegin[c] = (b == end) ? end : b + 1;
+   }
+
+   // a warning for line line of chunk (before the line numbers of the
+   // chunks are known): bad columns (false) or a bad number (true)
+   struct BadLine
+   {
+      int line;
+      bool number;
+   };
+   const unsigned int ncols = layout.ncols; // number of columns in XYZ file
+   vector<int> nlines(nchunk + 1, 0);
+   vector<int> nfound(nchunk + 1, 0);
+   vector<vector<BadLine> > badlines(nchunk);
+   threadpool().parallelfor(nchunk, 1, [&](int cb, int ce) {
+      for (int c = cb; c != ce; ++c) {
+         int line = 0;
+         for (const char* b = cbegin[c]; b != cbegin[c + 1]; ++line) {
+            const char* e = lineend(b, cbegin[c + 1]);
+            const unsigned int n = numcolumns(b, e, ncols);
+            if (n == ncols) {
+               ++nfound[c];
+            }
+            else if (n != 0) {
+               // check that we read correct number of columns
+               badlines[c].push_back(BadLine{line, false});
+            }
+            b = (e == cbegin[c + 1]) ? e : e + 1;
+         }
+         nlines[c] = line;
+      }
+   });
+
+   // first line and first particle of each chunk
+   vector<int> lineoffset(nchunk + 1, lfirst);
+   vector<int> paroffset(nchunk + 1, 0);
+   for (int c = 0; c != nchunk; ++c) {
+      lineoffset[c + 1] = lineoffset[c] + nlines[c];
+      paroffset[c + 1] = paroffset[c] + nfound[c];
+   }
+
+   allpars.resize(paroffset[nchunk]);
+   vector<char> bad(allpars.size(), 0);
+   threadpool().parallelfor(nchunk, 1, [&](int cb, int ce) {
+      for (int c = cb; c != ce; ++c) {
+         int line = 0;
+         int i = paroffset[c];
+         vector<BadLine> badnumbers;
+         for (const char* b = cbegin[c]; b != cbegin[c + 1]; ++line) {
+            const char* e = lineend(b, cbegin[c + 1]);
+            if (numcolumns(b, e, ncols) == ncols) {
+               if (!parseparticle(b, e, layout, gettypes, allpars[i])) {
+                  bad[i] = 1;
+                  badnumbers.push_back(BadLine{line, true});
+               }
+               ++i;
+            }
+            b = (e == cbegin[c + 1]) ? e : e + 1;
+         }
+         vector<BadLine> merged(badlines[c].size() + badnumbers.size());
+         std::merge(badlines[c].begin(), badlines[c].end(), badnumbers.begin(),
+                    badnumbers.end(), merged.begin(),
+                    [](const BadLine& x, const BadLine& y) { return x.line < y.line; });
+         badlines[c].swap(merged);
+      }
+   });
+   for (int c = 0; c != nchunk; ++c) {
+      for (vector<BadLine>::size_type w = 0; w != badlines[c].size(); ++w) {
+         const int lread = lineoffset[c] + badlines[c][w].line;
+         if (badlines[c][w].number) {
+            warn << "Warning: Error reading XYZ file, line "
+                 << lread << "." << endl;
+         }
+         else {
+            warn << "Warning: corrupt XYZ file, line " << lread << " expected "
+                 << ncols << " columns." << endl;
+         }
+      }
+   }
+
+   // remove any particles that couldn't be read
+   int nread = 0;
+   for (vector<Particle>::size_type i = 0; i != allpars.size(); ++i) {
+      if (!bad[i]) {
+         allpars[nread++] = allpars[i];
+      }
+   }
+
+   // check we read the correct number of particles
+   if (nread != npar) 
+      warn << "Warning: Did not read correct number of particles from "
+           << fname << " (" << nread << " of " << npar << " read)"
+           << endl;
+   allpars.resize(std::min(nread, npar));
+}
+
+// Read vector of particles from file in the normal XYZ format (or the
+// extended XYZ format, in which case the box is stored in box, if it
+// isn't null).  The file is memory mapped (or, if it is compressed,
+// decompressed into memory) and then parsed by parsexyz.  The warnings
+// are written to warn.
+
+vector<Particle> readxyz(const string fname, bool symbols, bool gettypes, FrameBox* box,
+                         std::ostream& warn)
+{
+   vector<Particle> allpars;
+   FrameBox framebox;
+   if (box) {
+      *box = framebox;
+   }
+
+   // a compressed file (see decompress.h) is decompressed into memory
+   // and parsed from there
+   if (compression(fname) != NOCOMPRESSION) {
+      std::unique_ptr<std::istream> in = openinput(fname, warn);
+      if (!in) {
+         // return empty vector of particles
+         return allpars;
+      }
+      std::ostringstream data;
+      data << in->rdbuf();
+      inputwarnings(*in, warn);
+      const string& text = data.str();
+      parsexyz(text.data(), text.data() + text.size(), fname, symbols, gettypes, allpars,
+               box ? *box : framebox, warn);
+      return allpars;
+   }
+
+   // check that file exists and can be read from
+   const int fd = open(fname.c_str(), O_RDONLY);
+   struct stat st;
+   if (fd == -1 || fstat(fd, &st) == -1) {
+      if (fd != -1) {
+         close(fd);
+      }
+      warn << "Warning: " << fname
+           << " does not exist or cannot be read." << endl;
       // return empty vector of particles
       return allpars;
    }
-   allpars.resize(npar);
+   const long size = st.st_size;
+   void* map = size ? mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+   close(fd);
+   const char* const begin = (map == MAP_FAILED) ? 0 : static_cast<const char*>(map);
+   parsexyz(begin, begin + (begin ? size : 0), fname, symbols, gettypes, allpars,
+            box ? *box : framebox, warn);
+   if (begin) {
+      munmap(map, size);
+   }
+   return allpars;
+}
 
+// Read the next frame of a trajectory in the XYZ format, i.e. a file
+// with several XYZ configurations one after the other.  The particles
+// are stored in pars, whose storage is reused, and lread is the number
+// of lines of the file read so far (for the warnings, which are
+// written to warn).  If box isn't null, the box of an extended XYZ
+// frame is stored in it.  Returns false if there are no more frames.
+
+bool readxyzframe(std::istream& infile, vector<Particle>& pars, int& lread,
+                  bool symbols, bool gettypes, FrameBox* box, std::ostream& warn)
+{
+   // read number of particles (top line of the frame), skipping any
+   // blank lines between frames
    string sline;
    vector<string> spline;
-   unsigned int ncols = 3 + symbols; // number of columns in XYZ file
-   Particle par;
-   int nread = 0;
-   int lread = 1;
-   int i = 0;
+   while (spline.empty()) {
+      if (!getline(infile, sline)) {
+         inputwarnings(infile, warn);
+         return false;
+      }
+      ++lread;
+      spline = split(sline);
+   }
+   const int npar = atoi(spline[0].c_str());
+   if (spline.size() != 1 || npar < 0) {
+      warn << "Warning: corrupt XYZ file, line " << lread
+           << " expected number of particles." << endl;
+      return false;
+   }
 
-   // invariant : we have successfully read nread particles
-   while (infile) {
+   // comment line, which may give the box and the layout of the lines
+   // for an extended XYZ file
+   getline(infile, sline);
+   ++lread;
+   XYZLayout layout(symbols);
+   FrameBox framebox;
+   parsecomment(sline.data(), sline.data() + sline.size(), layout, framebox);
+   if (box) {
+      *box = framebox;
+   }
 
-      getline(infile,sline);
+   pars.resize(npar);
+   unsigned int ncols = layout.ncols; // number of columns in XYZ file
+   int nread = 0;
+   while (nread != npar && getline(infile, sline)) {
       ++lread;
-      spline = split(sline);
+      const char* b = sline.data();
+      const char* e = b + sline.size();
+      const unsigned int n = numcolumns(b, e, ncols);
 
-      if (spline.empty()) { // we read a blank line
+      if (n == 0) { // we read a blank line
          continue;
       }
 
       // check that we read correct number of columns
-      if (spline.size() != ncols) {
-         cout << "Warning: corrupt XYZ file, line " << lread << " expected "
+      if (n != ncols) {
+         warn << "Warning: corrupt XYZ file, line " << lread << " expected "
               << ncols << " columns." << endl;
          continue;
       }
 
-      i = 0;
-      try {
-         if (symbols) { // note the symbol must only be a single character
-            par.symbol = spline[i++][0];
-            if (gettypes) 
-               par.type = partypes[par.symbol];
+      if (!parseparticle(b, e, layout, gettypes, pars[nread])) {
+         warn << "Warning: Error reading XYZ file, line "
+              << lread << "." << endl;
+         continue;
+      }
+      ++nread;
+   }
+
+   // check we read the correct number of particles
+   if (nread != npar) {
+      warn << "Warning: Did not read correct number of particles for frame ending at line "
+           << lread << " (" << nread << " of " << npar << " read)" << endl;
+      pars.resize(nread);
+   }
+
+   // the end of a compressed input can be reached part way through
+   // the frame (see decompress.h)
+   inputwarnings(infile, warn);
+   return true;
+}
+
+// What each column of the ATOMS lines of a LAMMPS dump holds (only the
+// columns that are needed are read).
+
+enum LAMMPSCOLUMN {LSKIP, LID, LELEMENT, LX, LY, LZ};
+
+// The header of a frame of a LAMMPS dump: the number of atoms, the box
+// (whose lower corner is lo), what each column of the ATOMS lines
+// holds and, for each of x, y and z, whether the positions are scaled
+// (xs) and unwrapped (xu).
+
+struct LammpsHeader
+{
+   LammpsHeader() : npar(-1)
+   {
+      for (int d = 0; d != 3; ++d) {
+         lo[d] = 0.0;
+         scaled[d] = unwrapped[d] = false;
+         periodic[d] = true;
+      }
+   }
+
+   long npar;
+   FrameBox box;
+   double lo[3];
+   bool periodic[3];
+   vector<LAMMPSCOLUMN> columns;
+   bool scaled[3];
+   bool unwrapped[3];
+};
+
+// Read the header of the next frame of a LAMMPS dump, i.e. the ITEM
+// sections up to and including ITEM: ATOMS (items that aren't needed,
+// e.g. the timestep, are skipped).  Returns false if there are no more
+// frames or the header is corrupt (with a warning, written to warn).
+
+static bool readlammpsheader(std::istream& infile, int& lread, LammpsHeader& header,
+                             std::ostream& warn)
+{
+   header = LammpsHeader();
+   bool started = false;
+   bool gotbox = false;
+   string sline;
+   while (getline(infile, sline)) {
+      ++lread;
+      if (sline.compare(0, 5, "ITEM:") != 0) {
+         // the values of an item that isn't needed, or blank lines
+         // between frames
+         if (!started && !split(sline).empty()) {
+            warn << "Warning: corrupt LAMMPS dump, line " << lread
+                 << " expected ITEM: TIMESTEP." << endl;
+            return false;
+         }
+         continue;
+      }
+      started = true;
+      const vector<string> item = split(sline.substr(5));
+      if (item.size() >= 3 && item[0] == "NUMBER" && item[1] == "OF" && item[2] == "ATOMS") {
+         getline(infile, sline);
+         ++lread;
+         const char* b = std::find_if(sline.data(), sline.data() + sline.size(), notxyzspace);
+         std::from_chars_result res = std::from_chars(b, sline.data() + sline.size(),
+                                                      header.npar);
+         if (res.ec != std::errc() || header.npar < 0) {
+            warn << "Warning: corrupt LAMMPS dump, line " << lread
+                 << " expected number of atoms." << endl;
+            return false;
+         }
+      }
+      else if (item.size() >= 2 && item[0] == "BOX" && item[1] == "BOUNDS") {
+         // the tilt factors xy xz yz (for a triclinic box) and then
+         // the boundary of each dimension, pp if it is periodic
+         vector<string> flags;
+         for (vector<string>::size_type f = 2; f != item.size(); ++f) {
+            if (item[f] == "xy" || item[f] == "xz" || item[f] == "yz") {
+               header.box.nonorthogonal = true;
+            }
+            else {
+               flags.push_back(item[f]);
+            }
+         }
+         for (int d = 0; d != 3; ++d) {
+            getline(infile, sline);
+            ++lread;
+            double bounds[3];
+            const int n = todoubles(sline.data(), sline.data() + sline.size(), bounds, 3);
+            if (n < 2) {
+               warn << "Warning: corrupt LAMMPS dump, line " << lread
+                    << " expected box bounds." << endl;
+               return false;
+            }
+            header.lo[d] = bounds[0];
+            header.box.lbox[d] = bounds[1] - bounds[0];
+            header.periodic[d] = (d < static_cast<int>(flags.size())) ? flags[d] == "pp" : true;
+         }
+         header.box.found = !header.box.nonorthogonal;
+         header.box.pbcfound = (flags.size() == 3);
+         header.box.zperiodic = header.periodic[2];
+         gotbox = true;
+      }
+      else if (item.size() >= 1 && item[0] == "ATOMS") {
+         bool gotpos[3] = {false, false, false};
+         for (vector<string>::size_type c = 1; c != item.size(); ++c) {
+            const string& name = item[c];
+            LAMMPSCOLUMN col = LSKIP;
+            if (name == "id") {
+               col = LID;
+            }
+            else if (name == "element") {
+               col = LELEMENT;
+            }
+            else if (!name.empty() && name[0] >= 'x' && name[0] <= 'z'
+                     && (name.size() == 1 || name.substr(1) == "s" || name.substr(1) == "u"
+                         || name.substr(1) == "su")) {
+               const int d = name[0] - 'x';
+               col = static_cast<LAMMPSCOLUMN>(LX + d);
+               header.scaled[d] = (name.find('s') != string::npos);
+               header.unwrapped[d] = (name.find('u') != string::npos);
+               gotpos[d] = true;
+            }
+            header.columns.push_back(col);
          }
-         par.pos[0] = atof(spline[i++].c_str());
-         par.pos[1] = atof(spline[i++].c_str());
-         par.pos[2] = atof(spline[i].c_str());
+         if (header.npar < 0 || !gotbox || !gotpos[0] || !gotpos[1] || !gotpos[2]) {
+            warn << "Warning: corrupt LAMMPS dump, line " << lread << " frame must have"
+                 << " the number of atoms, the box bounds and x, y and z columns." << endl;
+            return false;
+         }
+         return true;
+      }
+   }
+   if (started) {
+      warn << "Warning: LAMMPS dump ends part way through the header of a frame, line "
+           << lread << "." << endl;
+   }
+   return false;
+}
+
+// Read an atom from the line [b, e) of a LAMMPS dump, which must have
+// a column for each of header.columns.  The positions are moved so that
+// the lower corner of the box is at the origin (and wrapped into the
+// box in the periodic directions, if they are unwrapped).  Returns
+// false if one of the numbers can't be read.
 
-         allpars[nread] = par;
-         ++nread ;
+static bool parseatom(const char* b, const char* e, const LammpsHeader& header, Particle& par,
+                      long& id)
+{
+   par.symbol = 'N';
+   for (vector<LAMMPSCOLUMN>::size_type c = 0; c != header.columns.size(); ++c) {
+      b = std::find_if(b, e, notxyzspace);
+      const char* te = std::find_if(b, e, xyzspace);
+      switch (header.columns[c]) {
+      case LID:
+         if (std::from_chars(b, te, id).ptr != te) {
+            return false;
+         }
+         break;
+      case LELEMENT:
+         par.symbol = *b;
+         break;
+      case LX:
+      case LY:
+      case LZ:
+         if (!todouble(b, te, par.pos[header.columns[c] - LX])) {
+            return false;
+         }
+         break;
+      default:
+         break;
+      }
+      b = te;
+   }
+   // the particle type comes from the symbol, as for an XYZ file (see
+   // parseparticle)
+   par.type = (par.symbol == 'O');
+   for (int d = 0; d != 3; ++d) {
+      const double l = header.box.lbox[d];
+      par.pos[d] = header.scaled[d] ? par.pos[d] * l : par.pos[d] - header.lo[d];
+      if (header.unwrapped[d] && header.periodic[d] && l > 0.0) {
+         par.pos[d] -= l * std::floor(par.pos[d] / l);
+      }
+   }
+   return true;
+}
+
+// Is fname a LAMMPS dump (i.e. does its first line start with ITEM:)?
+// A compressed LAMMPS dump (see decompress.h) is a LAMMPS dump too.
+
+bool islammpsdump(const string fname)
+{
+   if (!ifstream(fname.c_str()) || !supported(compression(fname))) {
+      return false;
+   }
+   std::unique_ptr<std::istream> in = openinput(fname);
+   string sline;
+   while (in && getline(*in, sline)) {
+      if (!split(sline).empty()) {
+         return sline.compare(0, 5, "ITEM:") == 0;
+      }
+   }
+   return false;
+}
+
+// Read the next frame of a LAMMPS text dump (made by the dump atom or
+// dump custom commands), as for readxyzframe, storing the box of the
+// frame in box if it isn't null.  The ATOMS lines must have x, y and z
+// columns (or the scaled xs or unwrapped xu ones), and if there is an
+// id column the particles are sorted by id, so that they are in the
+// same order in every frame.  The symbol is the first letter of the
+// element column (N if there isn't one), and the particle type is
+// found from it in the same way as for an XYZ file (1 for O, 0 for
+// anything else).  The numeric LAMMPS type column isn't used, since
+// its values mean different things in different simulations.
+
+bool readlammpsframe(std::istream& infile, vector<Particle>& pars, int& lread, FrameBox* box,
+                     std::ostream& warn)
+{
+   LammpsHeader header;
+   if (!readlammpsheader(infile, lread, header, warn)) {
+      inputwarnings(infile, warn);
+      return false;
+   }
+   if (box) {
+      *box = header.box;
+   }
+
+   const long npar = header.npar;
+   const unsigned int ncols = header.columns.size();
+   pars.resize(npar);
+   vector<long> ids(npar, 0);
+   long nread = 0;
+   string sline;
+   while (nread != npar && getline(infile, sline)) {
+      ++lread;
+      const char* b = sline.data();
+      const char* e = b + sline.size();
+      const unsigned int n = numcolumns(b, e, ncols);
+
+      if (n == 0) { // we read a blank line
+         continue;
       }
-      catch (...) {
-         cout << "Warning: Error reading XYZ file, line "
+
+      // check that we read correct number of columns
+      if (n != ncols) {
+         warn << "Warning: corrupt LAMMPS dump, line " << lread << " expected "
+              << ncols << " columns." << endl;
+         continue;
+      }
+
+      if (!parseatom(b, e, header, pars[nread], ids[nread])) {
+         warn << "Warning: Error reading LAMMPS dump, line "
               << lread << "." << endl;
+         continue;
       }
+      ++nread;
    }
 
    // check we read the correct number of particles
-   if (nread != npar) 
-      cout << "Warning: Did not read correct number of particles from "
-           << fname << " (" << nread << " of " << npar << " read)"
-           << endl;
+   if (nread != npar) {
+      warn << "Warning: Did not read correct number of particles for frame ending at line "
+           << lread << " (" << nread << " of " << npar << " read)" << endl;
+      pars.resize(nread);
+      ids.resize(nread);
+   }
 
-   return allpars;
+   // LAMMPS writes the atoms in any order unless dump_modify sort is
+   // used.  The particles are permuted in place, following each cycle
+   // of the permutation, so that the storage of pars is still the one
+   // passed in (which is reused from frame to frame)
+   if (!std::is_sorted(ids.begin(), ids.end())) {
+      vector<long> order(nread);
+      for (long i = 0; i != nread; ++i) {
+         order[i] = i;
+      }
+      std::stable_sort(order.begin(), order.end(),
+                       [&](long i, long j) { return ids[i] < ids[j]; });
+      for (long i = 0; i != nread; ++i) {
+         if (order[i] == i) {
+            continue;
+         }
+         const Particle first = pars[i];
+         long j = i;
+         while (order[j] != i) {
+            pars[j] = pars[order[j]];
+            const long next = order[j];
+            order[j] = j;
+            j = next;
+         }
+         pars[j] = first;
+         order[j] = j;
+      }
+   }
+
+   inputwarnings(infile, warn);
+   return true;
+}
+
+// Box of the first frame of the XYZ file or LAMMPS dump fname (see
+// FrameBox), which is read without reading any of the particles.  No
+// warnings are given, since they are given when the frame is read.
+
+FrameBox readframebox(const string fname)
+{
+   FrameBox box;
+   if (!ifstream(fname.c_str()) || !supported(compression(fname))) {
+      return box;
+   }
+   std::unique_ptr<std::istream> in = openinput(fname);
+   if (!in) {
+      return box;
+   }
+   int lread = 0;
+   if (islammpsdump(fname)) {
+      LammpsHeader header;
+      std::ostringstream unused;
+      if (readlammpsheader(*in, lread, header, unused)) {
+         box = header.box;
+      }
+      return box;
+   }
+
+   // the comment line after the number of particles
+   string sline;
+   while (getline(*in, sline) && split(sline).empty()) {
+   }
+   if (getline(*in, sline)) {
+      XYZLayout layout(true);
+      parsecomment(sline.data(), sline.data() + sline.size(), layout, box);
+   }
+   return box;
 }
@@ -3,9 +3,43 @@
 
 #include "particle.h"
 #include <string>
+#include <istream>
+#include <iostream>
+#include <map>
+#include <vector>
+
+// Box of a frame, for files that give it with each frame: the Lattice
+// (and pbc) on the comment line of an extended XYZ frame, or the BOX
+// BOUNDS of a frame of a LAMMPS dump.  Only an orthorhombic box can be
+// used, so for a box with tilted sides found is false and
+// nonorthogonal is true.
+
+struct FrameBox
+{
+   FrameBox() : found(false), nonorthogonal(false), pbcfound(false), zperiodic(false)
+   {
+      lbox[0] = lbox[1] = lbox[2] = 0.0;
+   }
+
+   bool found;
+   double lbox[3];
+   bool nonorthogonal;
+   bool pbcfound;
+   bool zperiodic;
+};
 
 std::map<std::string, std::string> readparams(const std::string fname);
-std::vector<Particle> readxyz(const std::string fname, bool symbols = true, bool gettypes = true);
+std::vector<Particle> readxyz(const std::string fname, bool symbols = true, bool gettypes = true,
+                              FrameBox* box = 0, std::ostream& warn = std::cout);
+bool readxyzframe(std::istream& infile, std::vector<Particle>& pars, int& lread,
+                  bool symbols = true, bool gettypes = true, FrameBox* box = 0,
+                  std::ostream& warn = std::cout);
+bool islammpsdump(const std::string fname);
+bool readlammpsframe(std::istream& infile, std::vector<Particle>& pars, int& lread,
+                     FrameBox* box = 0, std::ostream& warn = std::cout);
+FrameBox readframebox(const std::string fname);
+unsigned int numcolumns(const char* b, const char* e, unsigned int maxcols);
+unsigned int xyzcolumns(const char* b, const char* e, bool symbols = true);
 void writexyz(std::vector<Particle> pars, const std::string fname, bool writesymbols = true);
 
 #endif
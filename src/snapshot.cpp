@@ -0,0 +1,277 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include <cstddef>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "particle.h"
+#include "threadpool.h"
+#include "decompress.h"
+#include "snapshot.h"
+
+using std::vector;
+using std::string;
+using std::cout;
+using std::endl;
+
+static const char SNAPSHOTMAGIC[8] = {'O', 'P', 'S', 'N', 'A', 'P', '\0', '\0'};
+static const int SNAPSHOTVERSION = 1;
+
+// Offset of the symbols and of the first frame in the file (the frames
+// start on an 8 byte boundary).
+
+static long symboloffset()
+{
+   return sizeof(SnapshotHeader);
+}
+
+static long frameoffset(long npar)
+{
+   return symboloffset() + (npar + 7) / 8 * 8;
+}
+
+bool issnapshot(const string& fname)
+{
+   char magic[sizeof(SNAPSHOTMAGIC)];
+   if (compression(fname) != NOCOMPRESSION) {
+      if (!supported(compression(fname))) {
+         return false;
+      }
+      std::unique_ptr<std::istream> in = openinput(fname);
+      return in && in->read(magic, sizeof(magic))
+             && memcmp(magic, SNAPSHOTMAGIC, sizeof(magic)) == 0;
+   }
+   std::ifstream infile(fname.c_str(), std::ios::binary);
+   return infile.read(magic, sizeof(magic))
+          && memcmp(magic, SNAPSHOTMAGIC, sizeof(magic)) == 0;
+}
+
+// Is h the header of a snapshot file (that can be read by this code)?
+
+static bool validheader(const SnapshotHeader& h)
+{
+   return memcmp(h.magic, SNAPSHOTMAGIC, sizeof(SNAPSHOTMAGIC)) == 0
+          && h.version == SNAPSHOTVERSION && h.npar >= 0 && h.nframes >= 0;
+}
+
+bool Snapshot::open(const string& _fname, std::ostream& warn)
+{
+   close();
+   fname = _fname;
+
+   // a compressed file is read as a stream: the header and symbols
+   // now, and the frames as they are asked for
+   if (compression(fname) != NOCOMPRESSION) {
+      in = openinput(fname, warn);
+      if (!in) {
+         return false;
+      }
+      if (!in->read(reinterpret_cast<char*>(&inheader), sizeof(inheader))
+          || !validheader(inheader)) {
+         warn << "Warning: " << fname << " is not a snapshot file (or was written"
+              << " with a different version or byte order)." << endl;
+         close();
+         return false;
+      }
+      insymbols.resize(frameoffset(inheader.npar) - symboloffset());
+      in->read(insymbols.data(), insymbols.size());
+      header = &inheader;
+      symbols = insymbols.data();
+      nframes = header->nframes;
+      nextframe = 0;
+      return true;
+   }
+
+   const int fd = ::open(fname.c_str(), O_RDONLY);
+   struct stat st;
+   if (fd == -1 || fstat(fd, &st) == -1) {
+      if (fd != -1) {
+         ::close(fd);
+      }
+      warn << "Warning: " << fname
+           << " does not exist or cannot be read." << endl;
+      return false;
+   }
+   size = st.st_size;
+   map = (size >= symboloffset())
+         ? mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+   ::close(fd);
+   if (map == MAP_FAILED) {
+      map = 0;
+      warn << "Warning: " << fname << " is not a snapshot file." << endl;
+      return false;
+   }
+
+   const SnapshotHeader* h = static_cast<const SnapshotHeader*>(map);
+   if (!validheader(*h) || size < frameoffset(h->npar)) {
+      warn << "Warning: " << fname << " is not a snapshot file (or was written"
+           << " with a different version or byte order)." << endl;
+      close();
+      return false;
+   }
+   header = h;
+   symbols = static_cast<const char*>(map) + symboloffset();
+
+   // a file that is shorter than the header says, e.g. if it is still
+   // being written, only has the frames that are complete
+   nframes = header->nframes;
+   const long framebytes = 3 * sizeof(double) * header->npar;
+   if (framebytes != 0 && (size - frameoffset(header->npar)) / framebytes < nframes) {
+      nframes = (size - frameoffset(header->npar)) / framebytes;
+      warn << "Warning: " << fname << " is truncated (" << nframes << " of "
+           << header->nframes << " frames read)" << endl;
+   }
+   return true;
+}
+
+void Snapshot::close()
+{
+   if (map) {
+      munmap(map, size);
+   }
+   map = 0;
+   size = 0;
+   header = 0;
+   in.reset();
+}
+
+const double* Snapshot::positions(long k, std::ostream& warn)
+{
+   if (k < 0 || k >= nframes) {
+      return 0;
+   }
+   if (!in) {
+      const char* base = static_cast<const char*>(map) + frameoffset(header->npar);
+      return reinterpret_cast<const double*>(base + 3 * sizeof(double) * header->npar * k);
+   }
+
+   // read (and skip) frames of the compressed file up to frame k
+   if (k < nextframe - 1 || (k == nextframe - 1 && inpos.empty())) {
+      warn << "Warning: " << fname << " is compressed, so frame " << k
+           << " can't be read after frame " << nextframe - 1 << "." << endl;
+      return 0;
+   }
+   inpos.resize(3 * header->npar);
+   while (nextframe <= k) {
+      if (!in->read(reinterpret_cast<char*>(inpos.data()), inpos.size() * sizeof(double))) {
+         inputwarnings(*in, warn);
+         warn << "Warning: " << fname << " is truncated (" << nextframe << " of "
+              << header->nframes << " frames read)" << endl;
+         nframes = nextframe;
+         inpos.clear();
+         return 0;
+      }
+      ++nextframe;
+   }
+   return inpos.data();
+}
+
+bool Snapshot::frame(long k, vector<Particle>& pars, std::ostream& warn)
+{
+   const double* pos = positions(k, warn);
+   if (!pos) {
+      pars.clear();
+      return false;
+   }
+   const int npar = header->npar;
+   pars.resize(npar);
+   threadpool().parallelfor(npar, PARCHUNK, [&](int begin, int end) {
+      for (int i = begin; i != end; ++i) {
+         Particle& par = pars[i];
+         par.pos[0] = pos[3 * i];
+         par.pos[1] = pos[3 * i + 1];
+         par.pos[2] = pos[3 * i + 2];
+         par.symbol = symbols[i];
+         // particle type from the symbol, as in readxyz
+         par.type = (par.symbol == 'O');
+      }
+   });
+   return true;
+}
+
+SnapshotWriter::SnapshotWriter(const string& _fname, double lx, double ly, double lz,
+                               bool zperiodic, long nsurf)
+   : file(std::fopen(_fname.c_str(), "wb")), fname(_fname)
+{
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, SNAPSHOTMAGIC, sizeof(SNAPSHOTMAGIC));
+   header.version = SNAPSHOTVERSION;
+   header.zperiodic = zperiodic;
+   header.npar = -1;
+   header.nframes = 0;
+   header.nsurf = nsurf;
+   header.lbox[0] = lx;
+   header.lbox[1] = ly;
+   header.lbox[2] = lz;
+   if (!file) {
+      cout << "Warning: " << fname << " cannot be written." << endl;
+   }
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+   if (file) {
+      std::fclose(file);
+   }
+}
+
+bool SnapshotWriter::write(const vector<Particle>& pars)
+{
+   if (!file) {
+      return false;
+   }
+   const long npar = pars.size();
+
+   // the first frame also writes the header and the symbols
+   if (header.npar == -1) {
+      header.npar = npar;
+      vector<char> symbols(frameoffset(npar) - symboloffset(), '\0');
+      for (long i = 0; i != npar; ++i) {
+         symbols[i] = pars[i].symbol;
+      }
+      if (std::fwrite(&header, sizeof(header), 1, file) != 1
+          || std::fwrite(symbols.data(), 1, symbols.size(), file) != symbols.size()) {
+         cout << "Warning: " << fname << " cannot be written." << endl;
+         return false;
+      }
+   }
+   else if (npar != header.npar) {
+      cout << "Warning: frame " << header.nframes << " has " << npar
+           << " particles, but the snapshot " << fname << " has " << header.npar
+           << ", frame not written." << endl;
+      return false;
+   }
+
+   vector<double> pos(3 * npar);
+   for (long i = 0; i != npar; ++i) {
+      pos[3 * i] = pars[i].pos[0];
+      pos[3 * i + 1] = pars[i].pos[1];
+      pos[3 * i + 2] = pars[i].pos[2];
+   }
+   if (std::fwrite(pos.data(), sizeof(double), pos.size(), file) != pos.size()) {
+      cout << "Warning: " << fname << " cannot be written." << endl;
+      return false;
+   }
+
+   // update the number of frames in the header
+   ++header.nframes;
+   const long end = std::ftell(file);
+   std::fseek(file, offsetof(SnapshotHeader, nframes), SEEK_SET);
+   std::fwrite(&header.nframes, sizeof(header.nframes), 1, file);
+   std::fseek(file, end, SEEK_SET);
+   std::fflush(file);
+   return true;
+}
+
+void writesnapshot(const vector<Particle>& pars, const string& fname, double lx, double ly,
+                   double lz, bool zperiodic, long nsurf)
+{
+   SnapshotWriter writer(fname, lx, ly, lz, zperiodic, nsurf);
+   writer.write(pars);
+}
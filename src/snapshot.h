@@ -0,0 +1,124 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <istream>
+#include <iostream>
+#include "particle.h"
+
+// A snapshot file is a binary alternative to the XYZ file (and the box
+// parameters in the parameter file): a header with the box lengths,
+// whether the box is periodic in z and the number of surface
+// particles, then the particle symbols, then the positions of one or
+// more frames (x, y and z of each particle in turn, as doubles).  All
+// of the values are in the native byte order.  The positions are
+// stored exactly (unlike writexyz, which writes 8 decimal places), the
+// file is around a third of the size of the XYZ file, and a frame can
+// be read without reading the frames before it.
+
+struct SnapshotHeader
+{
+   char magic[8];
+   std::int32_t version;
+   std::int32_t zperiodic;
+   std::int64_t npar;
+   std::int64_t nframes;
+   std::int64_t nsurf;
+   double lbox[3];
+};
+
+// Is fname a snapshot file (rather than e.g. an XYZ file)?  A
+// compressed snapshot file (see decompress.h) is a snapshot file too.
+
+bool issnapshot(const std::string&);
+
+// Snapshot gives access to the frames of a snapshot file, which is
+// memory mapped, so that only the frames that are used are read from
+// disk.  A compressed snapshot file can only be read in order, so the
+// frames must be asked for in increasing order (any frames in between
+// are skipped).
+
+class Snapshot
+{
+public:
+   Snapshot() : map(0), size(0), header(0) { }
+   explicit Snapshot(const std::string& fname) : map(0), size(0), header(0) { open(fname); }
+   ~Snapshot() { close(); }
+   Snapshot(const Snapshot&) = delete;
+   Snapshot& operator=(const Snapshot&) = delete;
+
+   // map the file fname (or start reading it, if it is compressed),
+   // returns false (with a warning, written to warn) if it can't be
+   // read or isn't a snapshot file
+   bool open(const std::string&, std::ostream& warn = std::cout);
+   void close();
+   bool isopen() const { return header != 0; }
+
+   long numparticles() const { return header->npar; }
+   long numframes() const { return nframes; }
+   long numsurface() const { return header->nsurf; }
+   double lbox(int d) const { return header->lbox[d]; }
+   bool zperiodic() const { return header->zperiodic; }
+
+   // positions of frame k, straight from the mapped file (or read
+   // from a compressed file), or null if frame k can't be read (with
+   // a warning, written to warn)
+   const double* positions(long k, std::ostream& warn = std::cout);
+
+   // the particles of frame k (as readxyz would give for an XYZ file),
+   // the storage of pars is reused; returns false (with a warning) if
+   // frame k can't be read
+   bool frame(long k, std::vector<Particle>& pars, std::ostream& warn = std::cout);
+
+private:
+   std::string fname;
+   void* map;
+   long size;
+   const SnapshotHeader* header;
+   const char* symbols;
+   long nframes;
+
+   // for a compressed file, the stream it is read from, the header and
+   // symbols, the next frame in the stream and the positions of the
+   // last frame read
+   std::unique_ptr<std::istream> in;
+   SnapshotHeader inheader;
+   std::vector<char> insymbols;
+   long nextframe;
+   std::vector<double> inpos;
+};
+
+// SnapshotWriter writes a snapshot file one frame at a time.  The
+// number of frames in the header is updated after each frame, so the
+// file is complete even if the writer is never finished.
+
+class SnapshotWriter
+{
+public:
+   SnapshotWriter(const std::string& fname, double lx, double ly, double lz, bool zperiodic,
+                  long nsurf);
+   ~SnapshotWriter();
+   SnapshotWriter(const SnapshotWriter&) = delete;
+   SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+   // append a frame, the first frame sets the number of particles
+   // and their symbols; returns false (with a warning) if the number
+   // of particles is different or the file can't be written
+   bool write(const std::vector<Particle>&);
+
+private:
+   std::FILE* file;
+   std::string fname;
+   SnapshotHeader header;
+};
+
+// Write vector of particles to a snapshot file with a single frame.
+
+void writesnapshot(const std::vector<Particle>&, const std::string&, double, double, double,
+                   bool, long);
+
+#endif
@@ -0,0 +1,56 @@
+#include <vector>
+#include <functional>
+#include "threadpool.h"
+#include "taskgraph.h"
+
+using std::vector;
+using std::function;
+
+int TaskGraph::add(const function<void()>& f, const vector<int>& deps)
+{
+   const int t = tasks.size();
+   tasks.push_back(f);
+   succ.push_back(vector<int>());
+   ndeps.push_back(deps.size());
+   for (vector<int>::size_type i = 0; i != deps.size(); ++i) {
+      succ[deps[i]].push_back(t);
+   }
+   return t;
+}
+
+// Queue task t on the pool.  Once it has finished, any tasks for
+// which it was the last unfinished dependency are queued in turn.
+// The counters are only changed under the pool lock (see
+// ThreadPool::notify).
+
+void TaskGraph::start(int t)
+{
+   pool.submit([this, t] {
+      tasks[t]();
+      vector<int> ready;
+      pool.notify([&] {
+         for (vector<int>::size_type i = 0; i != succ[t].size(); ++i) {
+            if (--pending[succ[t][i]] == 0) {
+               ready.push_back(succ[t][i]);
+            }
+         }
+         --remaining;
+      });
+      for (vector<int>::size_type i = 0; i != ready.size(); ++i) {
+         start(ready[i]);
+      }
+   });
+}
+
+void TaskGraph::run()
+{
+   pending = ndeps;
+   remaining = tasks.size();
+   for (vector<int>::size_type t = 0; t != tasks.size(); ++t) {
+      if (ndeps[t] == 0) {
+         start(t);
+      }
+   }
+   // the calling thread runs tasks too
+   pool.waitfor([this] { return remaining == 0; });
+}
@@ -0,0 +1,41 @@
+#ifndef TASKGRAPH_H
+#define TASKGRAPH_H
+
+#include <vector>
+#include <functional>
+#include "threadpool.h"
+
+// TaskGraph runs a set of tasks with dependencies between them on a
+// ThreadPool.  Each task is added along with the tasks that must
+// finish before it can start; when run is called, every task whose
+// dependencies are satisfied is queued on the pool, so that
+// independent tasks (e.g. QData for l = 4 and l = 6) run at the same
+// time.  Tasks can themselves use parallelfor on the same pool.
+
+class TaskGraph
+{
+public:
+   explicit TaskGraph(ThreadPool& _pool) : pool(_pool) { }
+
+   // add a task, returning its id for use as a dependency of later
+   // tasks (so the graph can't have cycles)
+   int add(const std::function<void()>& f,
+           const std::vector<int>& deps = std::vector<int>());
+
+   // run all of the tasks, returning once they have all finished
+   void run();
+
+private:
+   void start(int t);
+
+   ThreadPool& pool;
+   std::vector<std::function<void()> > tasks;
+   // tasks that depend on each task, and number of unfinished
+   // dependencies of each task
+   std::vector<std::vector<int> > succ;
+   std::vector<int> ndeps;
+   std::vector<int> pending;
+   int remaining;
+};
+
+#endif
@@ -0,0 +1,146 @@
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include "threadpool.h"
+
+using std::vector;
+using std::function;
+using std::mutex;
+using std::unique_lock;
+using std::lock_guard;
+
+// Constructor for thread pool, starts nthreads - 1 workers.
+
+ThreadPool::ThreadPool(int nthreads) : stop(false)
+{
+   for (int i = 1; i < nthreads; ++i) {
+      workers.push_back(std::thread(&ThreadPool::worker, this));
+   }
+}
+
+// Destructor, the workers finish any queued tasks and then exit.
+
+ThreadPool::~ThreadPool()
+{
+   {
+      lock_guard<mutex> lock(mtx);
+      stop = true;
+   }
+   cv.notify_all();
+   for (vector<std::thread>::size_type i = 0; i != workers.size(); ++i) {
+      workers[i].join();
+   }
+}
+
+// Worker thread: run tasks from the queue until the pool is stopped.
+
+void ThreadPool::worker()
+{
+   for (;;) {
+      function<void()> task;
+      {
+         unique_lock<mutex> lock(mtx);
+         cv.wait(lock, [this] { return stop || !tasks.empty(); });
+         if (tasks.empty()) {
+            return;
+         }
+         task = tasks.front();
+         tasks.pop_front();
+      }
+      task();
+   }
+}
+
+void ThreadPool::submit(const function<void()>& task)
+{
+   {
+      lock_guard<mutex> lock(mtx);
+      tasks.push_back(task);
+   }
+   cv.notify_all();
+}
+
+void ThreadPool::notify(const function<void()>& f)
+{
+   {
+      lock_guard<mutex> lock(mtx);
+      f();
+   }
+   cv.notify_all();
+}
+
+void ThreadPool::waitfor(const function<bool()>& done)
+{
+   for (;;) {
+      function<void()> task;
+      {
+         unique_lock<mutex> lock(mtx);
+         cv.wait(lock, [&] { return done() || !tasks.empty(); });
+         if (done()) {
+            return;
+         }
+         task = tasks.front();
+         tasks.pop_front();
+      }
+      task();
+   }
+}
+
+void ThreadPool::parallelfor(int n, int chunk, const function<void(int, int)>& f)
+{
+   chunk = std::max(chunk, 1);
+   const int nchunk = (n + chunk - 1) / chunk;
+   const int nhelp = std::min(static_cast<int>(workers.size()), nchunk - 1);
+
+   // serial case, no need for any synchronisation
+   if (nhelp <= 0) {
+      for (int b = 0; b < n; b += chunk) {
+         f(b, std::min(n, b + chunk));
+      }
+      return;
+   }
+
+   std::atomic<int> next(0);
+   int running = nhelp;
+   auto body = [&] {
+      for (;;) {
+         const int b = next.fetch_add(chunk);
+         if (b >= n) {
+            return;
+         }
+         f(b, std::min(n, b + chunk));
+      }
+   };
+
+   for (int h = 0; h != nhelp; ++h) {
+      submit([&] {
+         body();
+         notify([&] { --running; });
+      });
+   }
+   body();
+   waitfor([&] { return running == 0; });
+}
+
+// The process wide pool.
+
+static std::unique_ptr<ThreadPool> globalpool;
+
+ThreadPool& threadpool()
+{
+   if (!globalpool) {
+      globalpool.reset(new ThreadPool(1));
+   }
+   return *globalpool;
+}
+
+void setnumthreads(int nthreads)
+{
+   globalpool.reset(new ThreadPool(std::max(nthreads, 1)));
+}
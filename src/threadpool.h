@@ -0,0 +1,65 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// ThreadPool runs tasks on a fixed set of worker threads.  A pool of
+// size n has n - 1 workers; the thread that calls parallelfor (or
+// waitfor) does work too, so n threads are busy in total.  A thread
+// waiting for some work to finish runs queued tasks in the meantime,
+// so parallelfor can be called from inside a task without deadlock.
+//
+// The process wide pool (see threadpool below) is used by all of the
+// per-particle loops, e.g. in NeighbourList and QData.  Each loop
+// iteration only writes data belonging to its own particle, so the
+// results are identical for any number of threads.
+
+class ThreadPool
+{
+public:
+   explicit ThreadPool(int nthreads = 1);
+   ~ThreadPool();
+
+   // number of threads, including the calling thread
+   int size() const { return workers.size() + 1; }
+
+   // Call f(begin, end) for consecutive ranges of [0, n) of length
+   // chunk (the last may be shorter).  The ranges are handed out to
+   // the threads dynamically, one at a time, so that the work is
+   // balanced even if the cost per element is very uneven.
+   void parallelfor(int n, int chunk, const std::function<void(int, int)>& f);
+
+   // add a task to the queue
+   void submit(const std::function<void()>& task);
+
+   // run queued tasks until done() is true; done must only become
+   // true as a result of a call to notify
+   void waitfor(const std::function<bool()>& done);
+
+   // run f under the pool lock, then wake any waiting threads
+   void notify(const std::function<void()>& f);
+
+private:
+   void worker();
+
+   std::vector<std::thread> workers;
+   std::deque<std::function<void()> > tasks;
+   std::mutex mtx;
+   std::condition_variable cv;
+   bool stop;
+};
+
+// number of particles handed out to a thread at a time in the
+// per-particle loops
+const int PARCHUNK = 256;
+
+// the process wide thread pool, and setting its number of threads
+ThreadPool& threadpool();
+void setnumthreads(int nthreads);
+
+#endif
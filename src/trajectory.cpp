@@ -0,0 +1,266 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <charconv>
+#include <algorithm>
+#include <memory>
+#include "particlesystem.h"
+#include "readwrite.h"
+#include "snapshot.h"
+#include "frameindex.h"
+#include "decompress.h"
+#include "analysis.h"
+#include "boundedqueue.h"
+#include "trajectory.h"
+
+using std::string;
+using std::vector;
+using std::cout;
+using std::endl;
+
+// Number of frames that can be read ahead of the one being analysed,
+// and number of frames of output that can wait to be written.
+
+static const int NREADAHEAD = 2;
+static const int NWRITEAHEAD = 8;
+
+bool parseframes(const string& spec, FrameSelection& sel)
+{
+   // up to three fields separated by ':', each an integer or empty
+   vector<string> fields(1);
+   for (string::size_type c = 0; c != spec.size(); ++c) {
+      if (spec[c] == ':') {
+         fields.push_back("");
+      }
+      else {
+         fields.back() += spec[c];
+      }
+   }
+   if (fields.size() > 3) {
+      return false;
+   }
+   vector<long> values(fields.size());
+   vector<bool> given(fields.size());
+   for (vector<string>::size_type f = 0; f != fields.size(); ++f) {
+      given[f] = !fields[f].empty();
+      if (given[f]) {
+         const char* b = fields[f].data();
+         const char* e = b + fields[f].size();
+         std::from_chars_result res = std::from_chars(b, e, values[f]);
+         if (res.ec != std::errc() || res.ptr != e) {
+            return false;
+         }
+      }
+   }
+
+   sel = FrameSelection();
+   sel.all = false;
+   if (fields.size() == 1) {
+      // a single frame
+      if (!given[0]) {
+         return false;
+      }
+      sel.start = values[0];
+      sel.stop = (values[0] == -1) ? FrameSelection::END : values[0] + 1;
+      return true;
+   }
+   sel.start = given[0] ? values[0] : 0;
+   sel.stop = given[1] ? values[1] : FrameSelection::END;
+   sel.step = (fields.size() == 3 && given[2]) ? values[2] : 1;
+   return sel.step > 0;
+}
+
+// The frames selected by sel, for a trajectory with nframes frames.
+
+static vector<long> selectedframes(const FrameSelection& sel, const long nframes)
+{
+   long start = (sel.start < 0) ? sel.start + nframes : sel.start;
+   long stop = (sel.stop < 0) ? sel.stop + nframes : sel.stop;
+   start = std::max(0L, start);
+   stop = std::min(nframes, stop);
+   vector<long> frames;
+   for (long k = start; k < stop; k += sel.step) {
+      frames.push_back(k);
+   }
+   return frames;
+}
+
+// A frame passed from the reader to the analysis, with its box if the
+// file gives one for each frame, and the warnings given while reading
+// it (and any frames skipped before it).  The warnings go into the
+// output just before the frame, rather than straight to cout from the
+// reader thread, where they would be mixed up with the output being
+// written by the writer thread.
+
+struct TrajFrame
+{
+   long num;
+   vector<Particle> pars;
+   FrameBox box;
+   string warnings;
+};
+
+bool runtrajectory(ParticleSystem& psystem, FrameData& fd, const vector<OrderParam>& ops,
+                   const bool allclusters, const FrameSelection& sel, std::ostream& out)
+{
+   // the frames are from an XYZ file, a LAMMPS dump or a snapshot file
+   // (see snapshot.h), any of which can be compressed (see
+   // decompress.h)
+   Snapshot snap;
+   std::unique_ptr<std::istream> infile;
+   const bool binary = issnapshot(psystem.xyzfile);
+   const bool lammps = !binary && islammpsdump(psystem.xyzfile);
+   const bool compressed = (compression(psystem.xyzfile) != NOCOMPRESSION);
+   if (binary ? !snap.open(psystem.xyzfile) : !(infile = openinput(psystem.xyzfile))) {
+      return false;
+   }
+
+   // the frames to analyse: an XYZ file or LAMMPS dump is read
+   // straight through, skipping any frames that aren't wanted, unless
+   // it is an uncompressed XYZ file and only some of the frames are
+   // wanted, in which case the reader goes to each of them using the
+   // frame index
+   vector<long> frames;
+   FrameIndex index;
+   const bool indexed = !binary && !lammps && !compressed && !sel.all;
+   const bool sequential = !binary && !indexed;
+   if (binary) {
+      frames = selectedframes(sel, snap.numframes());
+   }
+   else if (indexed) {
+      index = frameindex(psystem.xyzfile);
+      frames = selectedframes(sel, index.num());
+   }
+   else if (sel.start < 0 || sel.stop < 0) {
+      cout << "Warning: " << psystem.xyzfile
+           << (lammps ? " is a LAMMPS dump" : " is compressed") << ", so the frames"
+           << " can't be counted from the end." << endl;
+      return false;
+   }
+
+   // the header line with the names of the order parameters (there is
+   // no header with -c, since each frame has its own tables)
+   if (!allclusters) {
+      out << "# frame";
+      for (vector<OrderParam>::size_type i = 0; i != ops.size(); ++i) {
+         out << " " << ops[i].first;
+      }
+      out << endl;
+   }
+
+   // particle storage goes from the reader to the analysis in full and
+   // back again in spare; there are enough buffers that the reader
+   // never waits for one unless it is NREADAHEAD frames ahead
+   BoundedQueue<TrajFrame> full(NREADAHEAD);
+   BoundedQueue<vector<Particle> > spare(NREADAHEAD + 1);
+   for (int b = 0; b != NREADAHEAD; ++b) {
+      spare.push(vector<Particle>());
+   }
+   BoundedQueue<string> output(NWRITEAHEAD);
+
+   // warnings from the reader after the last frame
+   string lastwarnings;
+
+   std::thread reader([&]() {
+      int lread = 0;
+      long k = 0;
+      vector<long>::size_type n = 0;
+      TrajFrame frame;
+      std::ostringstream warn;
+      while (spare.pop(frame.pars)) {
+         bool found = false;
+         if (sequential) {
+            // read frames until the next one that is wanted
+            while (!found && k < sel.stop
+                   && (lammps ? readlammpsframe(*infile, frame.pars, lread, &frame.box, warn)
+                              : readxyzframe(*infile, frame.pars, lread, true, true,
+                                             &frame.box, warn))) {
+               frame.num = k++;
+               found = (frame.num >= sel.start && (frame.num - sel.start) % sel.step == 0);
+            }
+         }
+         else if (n != frames.size()) {
+            frame.num = frames[n++];
+            if (binary) {
+               found = snap.frame(frame.num, frame.pars, warn);
+            }
+            else {
+               infile->clear();
+               infile->seekg(index.offset[frame.num]);
+               lread = index.line[frame.num] - 1;
+               found = readxyzframe(*infile, frame.pars, lread, true, true, &frame.box,
+                                    warn);
+            }
+         }
+         if (!found) {
+            break;
+         }
+         frame.warnings = warn.str();
+         warn.str("");
+         full.push(std::move(frame));
+      }
+      lastwarnings = warn.str();
+      full.close();
+   });
+
+   std::thread writer([&]() {
+      string text;
+      while (output.pop(text)) {
+         out << text;
+      }
+      out.flush();
+   });
+
+   // the box of each frame is used if the file gives it (e.g. for a
+   // simulation at constant pressure), unless the parameter file gives
+   // the box
+   TrajFrame trajframe;
+   bool warnedbox = false;
+   while (full.pop(trajframe)) {
+      const long frame = trajframe.num;
+      std::ostringstream ss;
+      commentlines(trajframe.warnings, ss);
+      if (trajframe.box.found && !psystem.fixedbox) {
+         psystem.simbox.setdims(trajframe.box.lbox[0], trajframe.box.lbox[1],
+                                trajframe.box.lbox[2]);
+      }
+      else if (trajframe.box.nonorthogonal && !psystem.fixedbox && !warnedbox) {
+         ss << "# Warning: the box of frame " << frame << " is not orthorhombic,"
+            << " so it is not used (this warning is only given once)."
+            << endl;
+         warnedbox = true;
+      }
+      psystem.allpars.swap(trajframe.pars);
+      spare.push(std::move(trajframe.pars));
+      psystem.update();
+      analyse(psystem, fd, allclusters);
+
+      if (allclusters) {
+         ss << "# frame " << frame << endl;
+         printallclusters(ss, psystem, fd);
+      }
+      else {
+         percolationwarnings(ss, fd, frame);
+         vector<string> opvals = opvalues(ops);
+         ss << frame;
+         for (vector<string>::size_type i = 0; i != opvals.size(); ++i) {
+            ss << " " << opvals[i];
+         }
+         ss << endl;
+      }
+      output.push(ss.str());
+   }
+   spare.close();
+   reader.join();
+   if (!lastwarnings.empty()) {
+      std::ostringstream ss;
+      commentlines(lastwarnings, ss);
+      output.push(ss.str());
+   }
+   output.close();
+   writer.join();
+   return true;
+}
@@ -0,0 +1,56 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <vector>
+#include <string>
+#include <climits>
+#include <iostream>
+#include "particlesystem.h"
+#include "analysis.h"
+
+// Frames of a trajectory to analyse, as for a python slice: from
+// frame start up to (but not including) frame stop, every step frames,
+// where a negative start or stop counts back from the end.  If all is
+// true, every frame is analysed.
+
+struct FrameSelection
+{
+   static const long END = LONG_MAX;
+
+   FrameSelection() : all(true), start(0), stop(END), step(1) { }
+
+   bool all;
+   long start;
+   long stop;
+   long step;
+};
+
+// Set sel from spec, which is either a single frame k, or
+// start:stop[:step] where any of the fields can be left out.  Returns
+// false if spec isn't valid.
+
+bool parseframes(const std::string&, FrameSelection&);
+
+// Analyse the frames selected by sel of the trajectory
+// psystem.xyzfile (an XYZ file, a LAMMPS dump or a snapshot file, see
+// snapshot.h) and write the order parameters to out, as a table with
+// one row per frame (or, if allclusters is true, the cluster tables
+// for each frame).  If the file gives the box of each frame (an
+// extended XYZ file or a LAMMPS dump, see readwrite.h), the box is
+// set for each frame, unless it is given in the parameter file.  If
+// only some of the frames of an XYZ file are selected, the frame
+// index (see frameindex.h) is used to go straight to each of them,
+// unless the file is compressed (see decompress.h), in which case the
+// frames in between are read and skipped.  The work is done by three
+// stages that run at the same time: a reader thread parses the next
+// few frames while the current frame is analysed (on the calling
+// thread and the thread pool), and a writer thread writes the output
+// of the frames that are done.  The stages are connected by bounded
+// queues (see boundedqueue.h), so that only a few frames are held in
+// memory, and the particle storage is passed back to the reader to be
+// reused.  Returns false if the file can't be read.
+
+bool runtrajectory(ParticleSystem&, FrameData&, const std::vector<OrderParam>&, bool,
+                   const FrameSelection&, std::ostream&);
+
+#endif
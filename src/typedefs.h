@@ -1,18 +1,13 @@
 #ifndef TYPEDEFS_H
 #define TYPEDEFS_H
 
-#include <boost/graph/adjacency_list.hpp>
 #include <boost/multi_array.hpp>
 
-// typedefs for use in the rest of the code.  array2d is a 2d array of
-// complex doubles, used for computing the spherical harmonics, and
-// qlm values; tensor is a 2d array of real numbers (double precision),
-// used for the gyration tensor.  graph is a boost adjacency list, used
-// for finding the number of connected components (and hence the size of
-// the largest crystalline cluster).
+// typedefs for use in the rest of the code.  tensor is a 2d array of
+// real numbers (double precision), used for the gyration tensor.
+// Note the qlm values are stored in a QlmArray (see qlmarray.h), and
+// clusters are found with union-find (see clusters.h).
 
-typedef boost::multi_array<std::complex<double>,2> array2d;
 typedef boost::multi_array<double,2> tensor;
-typedef boost:: adjacency_list <boost::vecS, boost::vecS, boost::undirectedS> graph;
 
 #endif
@@ -2,6 +2,8 @@
 #define UTILITY_H
 
 #include<vector>
+#include<cstddef>
+#include<new>
 
 // return vector containing integers ordered in range [start,end).
 
@@ -28,4 +30,40 @@ inline void reindex(std::vector<int>& indx1, const std::vector<int>& indx2)
    }
 }
 
+// Allocator for std::vector that aligns the storage to Align bytes
+// (by default 64, the size of a cache line and of an AVX-512
+// register).
+
+template <class T, std::size_t Align = 64>
+struct AlignedAllocator
+{
+   typedef T value_type;
+   template <class U> struct rebind { typedef AlignedAllocator<U, Align> other; };
+
+   AlignedAllocator() { }
+   template <class U> AlignedAllocator(const AlignedAllocator<U, Align>&) { }
+
+   T* allocate(std::size_t n)
+   {
+      return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Align)));
+   }
+
+   void deallocate(T* p, std::size_t)
+   {
+      ::operator delete(p, std::align_val_t(Align));
+   }
+};
+
+template <class T, class U, std::size_t Align>
+inline bool operator==(const AlignedAllocator<T, Align>&, const AlignedAllocator<U, Align>&)
+{
+   return true;
+}
+
+template <class T, class U, std::size_t Align>
+inline bool operator!=(const AlignedAllocator<T, Align>&, const AlignedAllocator<U, Align>&)
+{
+   return false;
+}
+
 #endif
@@ -0,0 +1,110 @@
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "constants.h"
+#include "wigner.h"
+
+using std::vector;
+
+// Factorial of n as a double (n <= 3 * MAXL + 1 is needed below, which
+// is far too big for an int).
+
+static double dfact(const int n)
+{
+   double f = 1.0;
+   for (int j = 2; j <= n; ++j) {
+      f *= j;
+   }
+   return f;
+}
+
+// Wigner 3j symbol (l1 l2 l3)
+//                  (m1 m2 m3)
+// from the Racah formula, see e.g. Edmonds, Angular Momentum in
+// Quantum Mechanics, equation (3.7.3).
+
+double wigner3j(const int l1, const int l2, const int l3,
+                const int m1, const int m2, const int m3)
+{
+   // selection rules
+   if (m1 + m2 + m3 != 0 || std::abs(m1) > l1 || std::abs(m2) > l2 ||
+       std::abs(m3) > l3 || l3 > l1 + l2 || l3 < std::abs(l1 - l2)) {
+      return 0.0;
+   }
+
+   const double tri = dfact(l1 + l2 - l3) * dfact(l1 - l2 + l3)
+                      * dfact(-l1 + l2 + l3) / dfact(l1 + l2 + l3 + 1);
+   const double pre = std::sqrt(tri * dfact(l1 + m1) * dfact(l1 - m1)
+                                * dfact(l2 + m2) * dfact(l2 - m2)
+                                * dfact(l3 + m3) * dfact(l3 - m3));
+
+   // sum over all k for which the factorials are of non-negative
+   // numbers
+   const int kmin = std::max(0, std::max(l2 - l3 - m1, l1 - l3 + m2));
+   const int kmax = std::min(l1 + l2 - l3, std::min(l1 - m1, l2 + m2));
+   double sum = 0.0;
+   for (int k = kmin; k <= kmax; ++k) {
+      const double term = 1.0 / (dfact(k) * dfact(l3 - l2 + k + m1)
+                                 * dfact(l3 - l1 + k - m2)
+                                 * dfact(l1 + l2 - l3 - k)
+                                 * dfact(l1 - k - m1) * dfact(l2 - k + m2));
+      sum += (k % 2 == 0) ? term : -term;
+   }
+
+   const int phase = l1 - l2 - m3;
+   return ((phase % 2 == 0) ? 1.0 : -1.0) * pre * sum;
+}
+
+// Table of symbols for a single l (see WignerTable).
+
+static WignerTable makewignertable(const int l)
+{
+   WignerTable table;
+   if (l % 2 == 1) {
+      return table;
+   }
+   for (int m1 = l; m1 >= -l; --m1) {
+      for (int m2 = m1; m2 >= -l; --m2) {
+         const int m3 = -m1 - m2;
+         // for -m3 > m1 the set is the negative of (-m3, -m2, -m1),
+         // which has an entry of its own
+         if (m3 > m2 || m3 < -l || -m3 > m1) {
+            continue;
+         }
+         const double w = wigner3j(l, l, l, m1, m2, m3);
+         if (w == 0.0) {
+            continue;
+         }
+         // number of distinct permutations of (m1, m2, m3)
+         int nperm = 6;
+         if (m1 == m2 && m2 == m3) {
+            nperm = 1;
+         }
+         else if (m1 == m2 || m2 == m3) {
+            nperm = 3;
+         }
+         table.m1.push_back(m1);
+         table.m2.push_back(m2);
+         table.m3.push_back(m3);
+         // unless the set is its own negative (m1 = -m3, m2 = 0),
+         // the entry stands for the negative set as well
+         if (m1 != -m3) {
+            nperm *= 2;
+         }
+         table.w.push_back(nperm * w);
+      }
+   }
+   return table;
+}
+
+const WignerTable& wignertable(const int l)
+{
+   static const vector<WignerTable> tables = [] {
+      vector<WignerTable> t;
+      for (int l = 0; l <= MAXL; ++l) {
+         t.push_back(makewignertable(l));
+      }
+      return t;
+   }();
+   return tables[l];
+}
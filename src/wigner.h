@@ -0,0 +1,35 @@
+#ifndef WIGNER_H
+#define WIGNER_H
+
+#include <vector>
+
+// Wigner 3j symbols, for computing wl for any value of l (see
+// constants.h for the hard coded values for l = 4 and 6).
+
+double wigner3j(int, int, int, int, int, int);
+
+// WignerTable stores the non-zero symbols (l  l  l )
+//                                         (m1 m2 m3)
+// for a single value of l, one entry for each distinct set
+// {m1, m2, m3} with m1 >= m2 >= m3 and m1 + m2 + m3 = 0, where a set
+// and its negative {-m1, -m2, -m3} share an entry (the one with
+// m1 >= -m3).  w is the value of the symbol multiplied by the number
+// of distinct permutations of (m1, m2, m3) and of its negative, so
+// that for q(-m) = (-1)^m q(m)*
+// sum_{m1 + m2 + m3 = 0} (l l l; m1 m2 m3) q(m1) q(m2) q(m3)
+// = sum_t w[t] Re(q(m1[t]) q(m2[t]) q(m3[t])),
+// the same layout as the hard coded tables in constants.h.
+// For odd l, these sums are all zero, and so the table is empty.
+
+struct WignerTable
+{
+   std::vector<int> m1;
+   std::vector<int> m2;
+   std::vector<int> m3;
+   std::vector<double> w;
+};
+
+// the table for 0 <= l <= MAXL, these are computed on first use
+const WignerTable& wignertable(int);
+
+#endif
@@ -0,0 +1,61 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <cstdlib>
+#include <map>
+#include <vector>
+#include "particle.h"
+#include "readwrite.h"
+#include "snapshot.h"
+#include "decompress.h"
+
+using std::vector;
+using std::map;
+using std::cout;
+using std::endl;
+using std::string;
+
+// Tool for converting an XYZ file (a single configuration or a
+// trajectory, and possibly compressed) to a snapshot file (see
+// snapshot.h).  This reads in a parameter file as for orderparams, and
+// writes every frame of the XYZ file given by 'filename', along with
+// the box dimensions, zperiodic and nparsurf, to the snapshot file.
+// The snapshot file can then be given as 'filename' in the parameter
+// file instead of the XYZ file.
+
+int main(int argc, char* argv[])
+{
+   if (argc != 3) {
+      cout << "Syntax: " << argv[0] << " paramfile snapshotfile" << endl;
+      return 1;
+   }
+
+   // input file must contain the following fields:
+   // filename   - name of xyz file to read positions from
+   // lboxx      - x dimension of simulation box
+   // lboxy      - y dimension     ""
+   // lboxz      - z dimension     ""
+   // zperiodic  - box periodic or not (either "True" or "False")
+   // nparsurf   - number of surface particles
+   map<string, string> params = readparams(argv[1]);
+   std::unique_ptr<std::istream> infile = openinput(params["filename"]);
+   if (!infile) {
+      return 1;
+   }
+
+   SnapshotWriter writer(argv[2], atof(params["lboxx"].c_str()),
+                         atof(params["lboxy"].c_str()), atof(params["lboxz"].c_str()),
+                         params["zperiodic"] == "True", atoi(params["nparsurf"].c_str()));
+   vector<Particle> pars;
+   int lread = 0;
+   int nframes = 0;
+   while (readxyzframe(*infile, pars, lread)) {
+      if (!writer.write(pars)) {
+         return 1;
+      }
+      ++nframes;
+   }
+   cout << "wrote " << nframes << " frames to " << argv[2] << endl;
+
+   return 0;
+}
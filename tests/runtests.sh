@@ -0,0 +1,139 @@
+#!/bin/sh
+# Tests for orderparams, ldtool and xyz2snap, run from the root
+# directory with 'make check' (which builds the executables first).
+#
+# The regression tests compare the output for the example in example/
+# with the output of the original code (tests/example.op and
+# tests/example.ld), which must not change.  The round trip tests
+# check that the other ways of reading the same configuration give
+# exactly the same output.
+
+cd "$(dirname "$0")/.." || exit 1
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+nfail=0
+
+# check name command...: run the command, which must succeed
+check()
+{
+   name=$1
+   shift
+   if "$@"; then
+      echo "PASS: $name"
+   else
+      echo "FAIL: $name"
+      nfail=$((nfail + 1))
+   fi
+}
+
+# params file: a copy of example/params.out for the XYZ (or other)
+# file given
+params()
+{
+   sed "s#^filename .*#filename $1#" example/params.out > "$2"
+}
+
+# row frame: the row of the -m output on stdin for the frame given
+row()
+{
+   grep "^$1 "
+}
+
+# regression tests, which must also give the same output for any
+# number of threads
+./orderparams example/params.out > "$tmp/op1"
+check "orderparams example" cmp -s tests/example.op "$tmp/op1"
+./orderparams -t 4 example/params.out > "$tmp/op4"
+check "orderparams -t 4 example" cmp -s tests/example.op "$tmp/op4"
+./ldtool example/params.out > "$tmp/ld1"
+check "ldtool example" cmp -s tests/example.ld "$tmp/ld1"
+./ldtool -t 4 example/params.out > "$tmp/ld4"
+check "ldtool -t 4 example" cmp -s tests/example.ld "$tmp/ld4"
+
+# a trajectory of three different frames with the same number of
+# particles: the example, and then the example with the particles
+# moved a little in x and y
+cat example/pos19_107.xyz > "$tmp/traj.xyz"
+for a in 0.03 0.06; do
+   awk -v a=$a 'NR <= 2 { print; next }
+                { printf "%s %.8f %.8f %s\n", $1, $2 + a * sin(NR), $3 + a * cos(NR), $4 }' \
+       example/pos19_107.xyz >> "$tmp/traj.xyz"
+done
+params "$tmp/traj.xyz" "$tmp/traj.params"
+./orderparams -m "$tmp/traj.params" > "$tmp/traj.op"
+check "trajectory" [ "$(grep -c -v '^#' "$tmp/traj.op")" -eq 3 ]
+
+# snapshot files: converting the example and the trajectory, and
+# writing the ldtool output to a snapshot, must all give back exactly
+# the same positions
+./xyz2snap example/params.out "$tmp/example.snap" > /dev/null
+params "$tmp/example.snap" "$tmp/snap.params"
+./orderparams "$tmp/snap.params" > "$tmp/snap.op"
+check "snapshot orderparams" cmp -s tests/example.op "$tmp/snap.op"
+./ldtool "$tmp/snap.params" > "$tmp/snap.ld"
+check "snapshot ldtool" cmp -s tests/example.ld "$tmp/snap.ld"
+./ldtool -o "$tmp/ld.snap" example/params.out
+params "$tmp/ld.snap" "$tmp/ldsnap.params"
+./ldtool "$tmp/ldsnap.params" > "$tmp/ldsnap.ld"
+check "ldtool -o snapshot" cmp -s tests/example.ld "$tmp/ldsnap.ld"
+./xyz2snap "$tmp/traj.params" "$tmp/traj.snap" > /dev/null
+params "$tmp/traj.snap" "$tmp/trajsnap.params"
+./orderparams -m "$tmp/trajsnap.params" > "$tmp/trajsnap.op"
+check "snapshot trajectory" cmp -s "$tmp/traj.op" "$tmp/trajsnap.op"
+row 2 < "$tmp/traj.op" > "$tmp/traj2.op"
+./orderparams -m -f 2 "$tmp/trajsnap.params" | row 2 > "$tmp/snapf2.op"
+check "snapshot trajectory -f 2" cmp -s "$tmp/traj2.op" "$tmp/snapf2.op"
+
+# frame index: the trajectory grows from two frames to three, with
+# the last frame only partly written for a while; the index made by
+# -f must then be extended, and give the same rows as reading the
+# whole file
+nlines=$(($(head -n 1 example/pos19_107.xyz) + 2))
+head -n $((2 * nlines)) "$tmp/traj.xyz" > "$tmp/grow.xyz"
+params "$tmp/grow.xyz" "$tmp/grow.params"
+row 1 < "$tmp/traj.op" > "$tmp/traj1.op"
+./orderparams -m -f 1 "$tmp/grow.params" | row 1 > "$tmp/grow1.op"
+check "frame index" cmp -s "$tmp/traj1.op" "$tmp/grow1.op"
+check "frame index file" [ -f "$tmp/grow.xyz.idx" ]
+tail -n +$((2 * nlines + 1)) "$tmp/traj.xyz" | head -n $((nlines / 2)) >> "$tmp/grow.xyz"
+./orderparams -m -f -1 "$tmp/grow.params" | row 1 > "$tmp/growpart.op"
+check "frame index, partly written frame" cmp -s "$tmp/traj1.op" "$tmp/growpart.op"
+tail -n +$((2 * nlines + nlines / 2 + 1)) "$tmp/traj.xyz" >> "$tmp/grow.xyz"
+check "frame index, grown file" cmp -s "$tmp/traj.xyz" "$tmp/grow.xyz"
+./orderparams -m -f -1 "$tmp/grow.params" | row 2 > "$tmp/grow2.op"
+check "frame index after growing" cmp -s "$tmp/traj2.op" "$tmp/grow2.op"
+./orderparams -m -f 0:3 "$tmp/grow.params" > "$tmp/growall.op"
+check "frame index, all frames" cmp -s "$tmp/traj.op" "$tmp/growall.op"
+
+# compressed input: the example, the trajectory and its snapshot,
+# compressed in each format that there is a command for, must give the
+# same output as the uncompressed files (a format that the build has
+# no library for must give a warning, but not stop the run)
+for z in gzip xz zstd; do
+   if ! command -v $z > /dev/null 2>&1; then
+      echo "SKIP: $z (no $z command)"
+      continue
+   fi
+   $z -c example/pos19_107.xyz > "$tmp/example.xyz.$z" 2> /dev/null
+   params "$tmp/example.xyz.$z" "$tmp/z.params"
+   ./orderparams "$tmp/z.params" > "$tmp/z.op" 2>&1
+   status=$?
+   if grep -q "can't read" "$tmp/z.op"; then
+      check "$z unsupported by this build" [ "$status" -eq 0 ]
+      continue
+   fi
+   check "$z orderparams" cmp -s tests/example.op "$tmp/z.op"
+   $z -c "$tmp/traj.xyz" > "$tmp/traj.xyz.$z" 2> /dev/null
+   params "$tmp/traj.xyz.$z" "$tmp/ztraj.params"
+   ./orderparams -m "$tmp/ztraj.params" > "$tmp/ztraj.op"
+   check "$z trajectory" cmp -s "$tmp/traj.op" "$tmp/ztraj.op"
+   ./orderparams -m -f 2 "$tmp/ztraj.params" | row 2 > "$tmp/ztraj2.op"
+   check "$z trajectory -f 2" cmp -s "$tmp/traj2.op" "$tmp/ztraj2.op"
+   $z -c "$tmp/traj.snap" > "$tmp/traj.snap.$z" 2> /dev/null
+   params "$tmp/traj.snap.$z" "$tmp/zsnap.params"
+   ./orderparams -m "$tmp/zsnap.params" > "$tmp/zsnap.op"
+   check "$z snapshot trajectory" cmp -s "$tmp/traj.op" "$tmp/zsnap.op"
+done
+
+echo "$nfail test(s) failed"
+[ "$nfail" -eq 0 ]